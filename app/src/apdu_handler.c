@@ -76,6 +76,10 @@ __Z_INLINE bool process_chunk(__Z_UNUSED volatile uint32_t *tx, uint32_t rx) {
             tx_initialize();
             tx_reset();
             extractHDPath(rx, OFFSET_DATA);
+            if (get_tx_type() == tx_type_json) {
+                tx_stream_start();
+                tx_hash_start(UINT32_MAX);
+            }
             tx_initialized = true;
             return false;
         case P1_ADD:
@@ -98,6 +102,7 @@ __Z_INLINE bool process_chunk(__Z_UNUSED volatile uint32_t *tx, uint32_t rx) {
                 tx_initialized = false;
                 THROW(APDU_CODE_OUTPUT_BUFFER_TOO_SMALL);
             }
+            tx_hash_finish();
             tx_initialized = false;
             return true;
         default:
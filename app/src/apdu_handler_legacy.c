@@ -35,7 +35,10 @@ void legacy_app_sign() {
     const uint8_t *message = tx_get_buffer();
     const uint16_t messageLength = tx_get_buffer_length() - hdpath_length;
 
-    const zxerr_t err = crypto_sign(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, message, messageLength, tx_type);
+    const uint8_t *digest = (tx_type == tx_type_json) ? tx_get_hash(messageLength) : NULL;
+    const zxerr_t err = (digest != NULL)
+                            ? crypto_signDigest(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, digest)
+                            : crypto_sign(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, message, messageLength, tx_type);
 
     if (err != zxerr_ok) {
         set_code(G_io_apdu_buffer, 0, APDU_CODE_SIGN_VERIFY_ERROR);
@@ -57,7 +60,9 @@ void legacy_app_sign_transference() {
     }
     MEMMOVE(G_io_apdu_buffer + SK_LEN_25519, G_io_apdu_buffer, action_addrResponseLen);
 
-    zxerr = crypto_sign(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, message, messageLength, tx_type);
+    const uint8_t *digest = tx_get_hash(messageLength);
+    zxerr = (digest != NULL) ? crypto_signDigest(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, digest)
+                             : crypto_sign(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, message, messageLength, tx_type);
 
     if (zxerr != zxerr_ok) {
         set_code(G_io_apdu_buffer, 0, APDU_CODE_SIGN_VERIFY_ERROR);
@@ -183,6 +188,10 @@ bool legacy_process_chunk(__Z_UNUSED volatile uint32_t *tx, uint32_t rx, bool ha
 
         tx_initialize();
         tx_reset();
+        if (has_len) {
+            // The hd path sent after the payload is not part of the signed message
+            tx_hash_start(payload_length);
+        }
         tx_initialized = true;
     }
 
@@ -190,6 +199,7 @@ bool legacy_process_chunk(__Z_UNUSED volatile uint32_t *tx, uint32_t rx, bool ha
 
     // Check if the end of the chunk is reached
     if ((rx < LEGACY_CHUNK_SIZE + LEGACY_HEADER_LENGTH) || legacy_check_end_of_chunk()) {
+        tx_hash_finish();
         tx_initialized = false;
         return true;
     }
@@ -22,35 +22,32 @@
 extern "C" {
 #endif
 
-buffer_json_state_t flash_json;  // Flash
+buffer_json_state_t json_buffer;  // RAM
 
-void buffering_json_init(uint8_t *flash_buffer, uint16_t flash_buffer_size) {
-    flash_json.data = flash_buffer;
-    flash_json.size = flash_buffer_size;
-    flash_json.pos = 0;
+void buffering_json_init(uint8_t *buffer, uint16_t buffer_size) {
+    json_buffer.data = buffer;
+    json_buffer.size = buffer_size;
+    json_buffer.pos = 0;
 }
 
-void buffering_json_reset() { flash_json.pos = 0; }
+void buffering_json_reset() { json_buffer.pos = 0; }
 
 int buffering_json_append(uint8_t *data, int length) {
-    if (data == NULL || flash_json.data == NULL) {
+    if (data == NULL || json_buffer.data == NULL) {
         return 0;
     }
 
-    // Flash in use, append to flash
-    if (flash_json.size - flash_json.pos >= length) {
-        MEMCPY_NV(flash_json.data + flash_json.pos, data, (size_t)length);
-        flash_json.pos += length;
-    } else {
+    if (json_buffer.size - json_buffer.pos < length) {
         return 0;
     }
 
+    MEMCPY(json_buffer.data + json_buffer.pos, data, (size_t)length);
+    json_buffer.pos += length;
+
     return length;
 }
 
-buffer_json_state_t *buffering_json_get_flash_buffer() { return &flash_json; }
-
-buffer_json_state_t *buffering_json_get_buffer() { return &flash_json; }
+buffer_json_state_t *buffering_json_get_buffer() { return &json_buffer; }
 
 #ifdef __cplusplus
 }
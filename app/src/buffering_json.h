@@ -20,6 +20,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -30,9 +31,9 @@ typedef struct {
 } buffer_json_state_t;
 
 /// Initialize buffer
-/// \param flash_buffer
-/// \param flash_buffer_size
-void buffering_json_init(uint8_t *flash_buffer, uint16_t flash_buffer_size);
+/// \param buffer
+/// \param buffer_size
+void buffering_json_init(uint8_t *buffer, uint16_t buffer_size);
 
 /// Reset buffer
 void buffering_json_reset();
@@ -43,12 +44,8 @@ void buffering_json_reset();
 /// \return the number of appended bytes
 int buffering_json_append(uint8_t *data, int length);
 
-/// buffering_get_flash_buffer
-/// \return
-buffer_json_state_t *buffering_json_get_flash_buffer();
-
-/// buffering_get_buffer
-/// \return
+/// buffering_json_get_buffer
+/// \return the RAM buffer that holds the JSON template
 buffer_json_state_t *buffering_json_get_buffer();
 
 #ifdef __cplusplus
@@ -54,7 +54,11 @@ __Z_INLINE void app_sign() {
         messageLength = tx_get_buffer_length();
     }
 
-    const zxerr_t err = crypto_sign(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, message, messageLength, tx_type);
+    // Json transactions are usually hashed while they are received, transfer templates while they are built
+    const uint8_t *digest = (tx_type != tx_type_hash) ? tx_get_hash(messageLength) : NULL;
+    const zxerr_t err = (digest != NULL)
+                            ? crypto_signDigest(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, digest)
+                            : crypto_sign(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 3, message, messageLength, tx_type);
 
     if (err != zxerr_ok) {
         set_code(G_io_apdu_buffer, 0, APDU_CODE_SIGN_VERIFY_ERROR);
@@ -28,6 +28,15 @@ uint16_t parser_get_json_template_buffer_len();
 const char *parser_getErrorDescription(parser_error_t err);
 const char *parser_getMsgPackTypeDescription(uint8_t type);
 
+//// starts tokenizing a json tx while its chunks are being received
+void parser_streamInit();
+
+//// stops any tokenization in progress, the next parse starts from scratch
+void parser_streamReset();
+
+//// tokenizes the tx data received so far
+parser_error_t parser_streamAppend(const uint8_t *data, size_t dataLen);
+
 //// parses a tx buffer
 parser_error_t parser_parse(parser_context_t *ctx, const uint8_t *data, size_t dataLen, tx_type_t tx_type);
 
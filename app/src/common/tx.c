@@ -19,16 +19,19 @@
 #include <string.h>
 
 #include "apdu_codes.h"
-#include "buffering.h"
 #include "buffering_json.h"
+#include "crypto_helper.h"
 #include "parser.h"
 #include "zxmacros.h"
 
-#define TEMPLATE_JSON_BUFFER_SIZE 1024
+// The transfer JSON template is built in the RAM buffer, next to the transfer data.
+// NanoS has no room for it in RAM, there it is written to flash
+// The flash buffer holds the longest input the JSON parser accepts
 #if !defined(TARGET_NANOS)
 #define RAM_BUFFER_SIZE 8192
-#define FLASH_BUFFER_SIZE 16384 - TEMPLATE_JSON_BUFFER_SIZE
+#define FLASH_BUFFER_SIZE JSMN_MAX_LENGTH
 #else
+#define TEMPLATE_JSON_BUFFER_SIZE 1024
 #define RAM_BUFFER_SIZE 256
 #define FLASH_BUFFER_SIZE 8192 - TEMPLATE_JSON_BUFFER_SIZE
 #endif
@@ -41,48 +44,382 @@ tx_type_t tx_type;
 // Flash
 typedef struct {
     uint8_t buffer[FLASH_BUFFER_SIZE];
+#if defined(TARGET_NANOS)
     uint8_t templete_json[TEMPLATE_JSON_BUFFER_SIZE];
+#endif
 } storage_t;
 
 #if defined(LEDGER_SPECIFIC)
-storage_t NV_CONST N_appdata_impl __attribute__((aligned(64)));
+storage_t NV_CONST N_appdata_impl __attribute__((aligned(TX_NVM_PAGE_SIZE)));
 #define N_appdata (*(NV_VOLATILE storage_t *)PIC(&N_appdata_impl))
 #else
-storage_t N_appdata_impl __attribute__((aligned(64)));
+storage_t N_appdata_impl __attribute__((aligned(TX_NVM_PAGE_SIZE)));
 #define N_appdata (*(storage_t *)PIC(&N_appdata_impl))
 #endif
 
+// Area of flash written through a staging page. Appends are copied to a RAM copy of the current page and
+// only complete pages are programmed, the last partial page once the data is read
+typedef struct {
+    uint8_t *nvm;
+    uint32_t size;
+    // Bytes appended
+    uint32_t pos;
+    // Bytes already programmed
+    uint32_t committed;
+    // RAM copy of the page that holds pos, NULL to program every append right away
+    uint8_t *page;
+} tx_nvm_t;
+
+// Transaction data stays in the RAM buffer while it fits, then it is moved to flash.
+// Once in flash the start of the RAM buffer is the staging page
+typedef struct {
+    uint16_t ram_pos;
+    bool in_flash;
+    tx_nvm_t flash;
+} tx_buffer_t;
+
+static tx_buffer_t tx_buffer;
+
+#if defined(TARGET_NANOS)
+static tx_nvm_t tx_json_nvm;
+#endif
+
+// Flash pages programmed since the last tx_reset
+static uint32_t tx_nvm_pages_written = 0;
+
 static parser_context_t ctx_parsed_tx;
 
+// Tokenize json transactions while their chunks are received
+static bool tx_stream_enabled = false;
+static uint32_t tx_stream_length = 0;
+
+// Set when a part of the JSON template did not fit
+static bool tx_json_overflow = false;
+
+// Hash json transactions while their chunks are received, so signing does not read the whole buffer again.
+// The context does not fit next to the NanoS buffers, there the digest is computed when it is needed
+#if !defined(TARGET_NANOS)
+#define TX_STREAM_HASH
+#endif
+
+#if defined(TX_STREAM_HASH)
+typedef enum {
+    tx_hash_off = 0,
+    tx_hash_absorbing,
+    tx_hash_done,
+} tx_hash_state_t;
+
+typedef struct {
+    blake2b_stream_t stream;
+    uint32_t limit;
+    uint32_t absorbed;
+    uint8_t digest[BLAKE2B_HASH_SIZE];
+    tx_hash_state_t state;
+} tx_hash_stream_t;
+
+static tx_hash_stream_t tx_hash_stream;
+#endif
+
 void set_tx_type(tx_type_t type) { tx_type = type; }
 
 tx_type_t get_tx_type() { return tx_type; }
 
-void tx_json_initialize() { buffering_json_init((uint8_t *)N_appdata.templete_json, FLASH_BUFFER_SIZE); }
+static void tx_hash_added(const uint8_t *buffer, uint32_t length, uint32_t added);
+
+static void tx_nvm_init(tx_nvm_t *nvm, uint8_t *buffer, uint32_t size, uint8_t *page) {
+    nvm->nvm = buffer;
+    nvm->size = size;
+    nvm->pos = 0;
+    nvm->committed = 0;
+    nvm->page = page;
+}
+
+static void tx_nvm_program(const tx_nvm_t *nvm, uint32_t offset, const uint8_t *data, uint32_t length) {
+    if (length == 0) {
+        return;
+    }
+    MEMCPY_NV(nvm->nvm + offset, data, length);
+    tx_nvm_pages_written += (offset + length - 1) / TX_NVM_PAGE_SIZE - offset / TX_NVM_PAGE_SIZE + 1;
+}
+
+// Programs the staged bytes, they all belong to the page that holds pos
+static void tx_nvm_commit(tx_nvm_t *nvm) {
+    if (nvm->committed == nvm->pos) {
+        return;
+    }
+    const uint32_t page_start = nvm->committed - (nvm->committed % TX_NVM_PAGE_SIZE);
+    tx_nvm_program(nvm, nvm->committed, nvm->page + (nvm->committed - page_start), nvm->pos - nvm->committed);
+    nvm->committed = nvm->pos;
+}
+
+static uint32_t tx_nvm_append(tx_nvm_t *nvm, const uint8_t *data, uint32_t length) {
+    if (data == NULL || nvm->size - nvm->pos < length) {
+        return 0;
+    }
+
+    if (nvm->page == NULL) {
+        tx_nvm_program(nvm, nvm->pos, data, length);
+        nvm->pos += length;
+        nvm->committed = nvm->pos;
+        return length;
+    }
+
+    uint32_t left = length;
+    while (left > 0) {
+        const uint32_t page_offset = nvm->pos % TX_NVM_PAGE_SIZE;
+        if (page_offset == 0 && left >= TX_NVM_PAGE_SIZE) {
+            // Whole pages are programmed straight from the input
+            const uint32_t whole = left - (left % TX_NVM_PAGE_SIZE);
+            tx_nvm_program(nvm, nvm->pos, data, whole);
+            nvm->pos += whole;
+            nvm->committed = nvm->pos;
+            data += whole;
+            left -= whole;
+            continue;
+        }
+
+        const uint32_t room = TX_NVM_PAGE_SIZE - page_offset;
+        const uint32_t len = (left < room) ? left : room;
+        MEMCPY(nvm->page + page_offset, data, len);
+        nvm->pos += len;
+        data += len;
+        left -= len;
+        if (len == room) {
+            tx_nvm_commit(nvm);
+        }
+    }
+    return length;
+}
+
+// Bytes at the start of the RAM buffer that hold transaction data
+static uint16_t tx_ram_used() { return tx_buffer.in_flash ? 0 : tx_buffer.ram_pos; }
+
+void tx_json_start() {
+    // The template uses the RAM buffer, the staged transaction data must be in flash first
+    tx_nvm_commit(&tx_buffer.flash);
+    const uint16_t used = tx_ram_used();
+#if defined(TARGET_NANOS)
+    // The free part of the RAM buffer is the staging page when there is room for one
+    uint8_t *page = (sizeof(ram_buffer) - used >= TX_NVM_PAGE_SIZE) ? ram_buffer + used : NULL;
+    tx_nvm_init(&tx_json_nvm, (uint8_t *)N_appdata.templete_json, sizeof(N_appdata.templete_json), page);
+#else
+    buffering_json_init(ram_buffer + used, (uint16_t)(sizeof(ram_buffer) - used));
+#endif
+    tx_json_overflow = false;
+    tx_hash_start(UINT32_MAX);
+}
+
+zxerr_t tx_json_finish() {
+    if (tx_json_overflow) {
+        return zxerr_buffer_too_small;
+    }
+#if defined(TARGET_NANOS)
+    tx_nvm_commit(&tx_json_nvm);
+#endif
+    tx_hash_finish();
+    return zxerr_ok;
+}
 
-void tx_json_reset() { buffering_json_reset(); }
+void tx_json_reset() {
+#if defined(TARGET_NANOS)
+    tx_nvm_init(&tx_json_nvm, (uint8_t *)N_appdata.templete_json, sizeof(N_appdata.templete_json), NULL);
+#else
+    buffering_json_reset();
+#endif
+}
 
-uint32_t tx_json_append(unsigned char *buffer, uint32_t length) { return buffering_json_append(buffer, length); }
+uint32_t tx_json_append(unsigned char *buffer, uint32_t length) {
+#if defined(TARGET_NANOS)
+    const uint32_t added = tx_nvm_append(&tx_json_nvm, buffer, length);
+#else
+    const uint32_t added = buffering_json_append(buffer, length);
+#endif
+    if (added != length) {
+        tx_json_overflow = true;
+    }
+    tx_hash_added(buffer, length, added);
+    return added;
+}
 
-uint32_t tx_json_get_buffer_length() { return buffering_json_get_buffer()->pos; }
+uint32_t tx_json_get_buffer_length() {
+#if defined(TARGET_NANOS)
+    return tx_json_nvm.pos;
+#else
+    return buffering_json_get_buffer()->pos;
+#endif
+}
 
-uint8_t *tx_json_get_buffer() { return buffering_json_get_buffer()->data; }
+uint8_t *tx_json_get_buffer() {
+#if defined(TARGET_NANOS)
+    tx_nvm_commit(&tx_json_nvm);
+    return tx_json_nvm.nvm;
+#else
+    return buffering_json_get_buffer()->data;
+#endif
+}
 
 void tx_initialize() {
-    buffering_init(ram_buffer, sizeof(ram_buffer), (uint8_t *)N_appdata.buffer, sizeof(N_appdata.buffer));
-    tx_json_initialize();
+    tx_buffer.ram_pos = 0;
+    tx_buffer.in_flash = false;
+    tx_nvm_init(&tx_buffer.flash, (uint8_t *)N_appdata.buffer, sizeof(N_appdata.buffer), ram_buffer);
 }
 
 void tx_reset() {
-    buffering_reset();
+    tx_initialize();
     tx_json_reset();
+    tx_nvm_pages_written = 0;
+    tx_stream_enabled = false;
+    tx_stream_length = 0;
+    parser_streamReset();
+#if defined(TX_STREAM_HASH)
+    tx_hash_stream.state = tx_hash_off;
+#endif
+}
+
+void tx_stream_start() {
+    parser_streamInit();
+    tx_stream_enabled = true;
+}
+
+void tx_hash_start(uint32_t length) {
+#if defined(TX_STREAM_HASH)
+    tx_hash_stream.limit = length;
+    tx_hash_stream.absorbed = 0;
+    tx_hash_stream.state = (blake2b_stream_init(&tx_hash_stream.stream) == zxerr_ok) ? tx_hash_absorbing : tx_hash_off;
+#else
+    UNUSED(length);
+#endif
+}
+
+void tx_hash_finish() {
+#if defined(TX_STREAM_HASH)
+    if (tx_hash_stream.state != tx_hash_absorbing) {
+        return;
+    }
+    tx_hash_stream.state = (blake2b_stream_final(&tx_hash_stream.stream, tx_hash_stream.digest) == zxerr_ok)
+                               ? tx_hash_done
+                               : tx_hash_off;
+#endif
+}
+
+const uint8_t *tx_get_hash(uint32_t length) {
+#if defined(TX_STREAM_HASH)
+    if (tx_hash_stream.state == tx_hash_done && tx_hash_stream.absorbed == length) {
+        return tx_hash_stream.digest;
+    }
+#else
+    UNUSED(length);
+#endif
+    return NULL;
+}
+
+// Absorbs the data that was appended, the digest is dropped when part of it did not fit
+static void tx_hash_added(const uint8_t *buffer, uint32_t length, uint32_t added) {
+#if defined(TX_STREAM_HASH)
+    if (tx_hash_stream.state != tx_hash_absorbing) {
+        return;
+    }
+    if (added != length) {
+        tx_hash_stream.state = tx_hash_off;
+        return;
+    }
+
+    const uint32_t left = tx_hash_stream.limit - tx_hash_stream.absorbed;
+    const uint32_t len = (length < left) ? length : left;
+    if (len == 0) {
+        return;
+    }
+
+    if (blake2b_stream_update(&tx_hash_stream.stream, buffer, len) != zxerr_ok) {
+        tx_hash_stream.state = tx_hash_off;
+        return;
+    }
+    tx_hash_stream.absorbed += len;
+#else
+    UNUSED(buffer);
+    UNUSED(length);
+    UNUSED(added);
+#endif
+}
+
+// Moves the data held in RAM to flash. Whole pages are programmed, the rest becomes the staging page
+static bool tx_move_to_flash() {
+    tx_nvm_t *flash = &tx_buffer.flash;
+    const uint32_t length = tx_buffer.ram_pos;
+    if (flash->size < length) {
+        return false;
+    }
+
+    const uint32_t whole = length - (length % TX_NVM_PAGE_SIZE);
+    tx_nvm_program(flash, 0, ram_buffer, whole);
+    MEMMOVE(ram_buffer, ram_buffer + whole, length - whole);
+    flash->pos = length;
+    flash->committed = whole;
+    tx_buffer.in_flash = true;
+    return true;
+}
+
+static uint32_t tx_buffer_append(const uint8_t *buffer, uint32_t length) {
+    if (buffer == NULL) {
+        return 0;
+    }
+
+    if (!tx_buffer.in_flash) {
+        if (sizeof(ram_buffer) - tx_buffer.ram_pos >= length) {
+            MEMCPY(ram_buffer + tx_buffer.ram_pos, buffer, length);
+            tx_buffer.ram_pos += length;
+            return length;
+        }
+        if (!tx_move_to_flash()) {
+            return 0;
+        }
+    }
+
+    return tx_nvm_append(&tx_buffer.flash, buffer, length);
 }
 
-uint32_t tx_append(unsigned char *buffer, uint32_t length) { return buffering_append(buffer, length); }
+uint32_t tx_append(unsigned char *buffer, uint32_t length) {
+    const uint32_t added = tx_buffer_append(buffer, length);
+
+    // Only the programmed part of the flash buffer can be read
+    const uint32_t available = tx_buffer.in_flash ? tx_buffer.flash.committed : tx_buffer.ram_pos;
+    if (tx_stream_enabled && added == length && available > tx_stream_length) {
+        // On error the stream is dropped and the whole buffer is parsed again once complete
+        const uint8_t *data = tx_buffer.in_flash ? tx_buffer.flash.nvm : ram_buffer;
+        if (parser_streamAppend(data, available) != parser_ok) {
+            tx_stream_enabled = false;
+        }
+        tx_stream_length = available;
+    }
+
+    tx_hash_added(buffer, length, added);
 
-uint32_t tx_get_buffer_length() { return buffering_get_buffer()->pos; }
+    return added;
+}
+
+uint8_t *tx_get_spill_buffer(uint16_t *length) {
+    // The staging page lives in the RAM buffer
+    tx_nvm_commit(&tx_buffer.flash);
+    uint16_t used = tx_ram_used();
+#if !defined(TARGET_NANOS)
+    // The JSON template follows the transaction data
+    used += buffering_json_get_buffer()->pos;
+#endif
+    *length = (uint16_t)(sizeof(ram_buffer) - used);
+    return ram_buffer + used;
+}
+
+uint32_t tx_get_buffer_length() { return tx_buffer.in_flash ? tx_buffer.flash.pos : tx_buffer.ram_pos; }
+
+uint8_t *tx_get_buffer() {
+    if (!tx_buffer.in_flash) {
+        return ram_buffer;
+    }
+    tx_nvm_commit(&tx_buffer.flash);
+    return tx_buffer.flash.nvm;
+}
 
-uint8_t *tx_get_buffer() { return buffering_get_buffer()->data; }
+uint32_t tx_get_nvm_pages_written() { return tx_nvm_pages_written; }
 
 const char *tx_parse(uint32_t buffer_length, tx_type_t tx_type_parse, uint8_t *error_code) {
     uint8_t err = parser_parse(&ctx_parsed_tx, tx_get_buffer(), buffer_length, tx_type_parse);
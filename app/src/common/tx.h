@@ -15,10 +15,21 @@
  ********************************************************************************/
 #pragma once
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #include "coin.h"
 #include "parser_txdef.h"
 #include "zxerror.h"
 
+/// Size of the flash pages, appends to flash are combined into writes of whole pages
+#if defined(TARGET_NANOS)
+#define TX_NVM_PAGE_SIZE 64
+#else
+#define TX_NVM_PAGE_SIZE 512
+#endif
+
 void tx_initialize();
 
 /// Sets the transaction type
@@ -32,6 +43,22 @@ tx_type_t get_tx_type();
 /// Clears the transaction buffer
 void tx_reset();
 
+/// Tokenizes the json transaction as it is appended, so that most of the parsing is done
+/// by the time the last chunk arrives. It must be called right after tx_reset
+void tx_stream_start();
+
+/// Hashes the transaction as it is appended. It must be called right after tx_reset
+/// \param length: only the first length bytes are hashed, the rest of the buffer is not part of the message
+void tx_hash_start(uint32_t length);
+
+/// Finalizes the digest of the appended data, once the last chunk has been received
+void tx_hash_finish();
+
+/// Returns the digest computed while the transaction was received
+/// \param length: length of the message to sign
+/// \return Pointer to BLAKE2B_HASH_SIZE bytes, or NULL when there is no digest for exactly that message
+const uint8_t *tx_get_hash(uint32_t length);
+
 /// Appends buffer to the end of the current transaction buffer
 /// Transaction buffer will grow until it reaches the maximum allowed size
 /// \param buffer
@@ -39,6 +66,14 @@ void tx_reset();
 /// \return It returns an error message if the buffer is too small.
 uint32_t tx_append(unsigned char *buffer, uint32_t length);
 
+/// Starts a new JSON template. It is written to the RAM buffer, after the transaction data,
+/// and hashed as it is appended
+void tx_json_start();
+
+/// Ends the JSON template and finalizes its digest
+/// \return zxerr_buffer_too_small if a part of the template did not fit
+zxerr_t tx_json_finish();
+
 /// Appends buffer to the end of JSON template buffer
 /// JSON template buffer will grow until it reaches the maximum allowed size
 /// \param buffer
@@ -54,14 +89,25 @@ uint8_t *tx_json_get_buffer();
 /// \return Length of the JSON template buffer
 uint32_t tx_json_get_buffer_length();
 
+/// Returns the part of the RAM buffer that does not hold transaction data or the JSON template, the whole
+/// buffer once the data has been moved to flash. It is free until the next tx_reset
+/// \param length (out)
+/// \return Pointer to the free area
+uint8_t *tx_get_spill_buffer(uint16_t *length);
+
 /// Returns size of the raw json transaction buffer
 /// \return
 uint32_t tx_get_buffer_length();
 
 /// Returns the raw json transaction buffer
+/// Data staged for flash is programmed first, so the whole transaction can be read
 /// \return
 uint8_t *tx_get_buffer();
 
+/// Returns the number of flash pages programmed since the last tx_reset
+/// \return Number of pages
+uint32_t tx_get_nvm_pages_written();
+
 /// Parse message stored in transaction buffer
 /// This function should be called as soon as full buffer data is loaded.
 /// \return It returns NULL if data is valid or error message otherwise.
@@ -73,3 +119,7 @@ zxerr_t tx_getNumItems(uint8_t *num_items);
 /// Gets an specific item from the transaction (including paging)
 zxerr_t tx_getItem(int8_t displayIdx, char *outKey, uint16_t outKeyLen, char *outValue, uint16_t outValueLen,
                    uint8_t pageIdx, uint8_t *pageCount);
+
+#ifdef __cplusplus
+}
+#endif
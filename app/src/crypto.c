@@ -25,7 +25,36 @@
 
 uint32_t hdPath[HDPATH_LEN_DEFAULT];
 
-zxerr_t crypto_extractPublicKey(uint8_t *pubKey, uint16_t pubKeyLen) {
+// Public keys of the most recently used derivation paths.
+// With PUBKEY_CACHE_NVM the entries are kept in flash so they survive app restarts, otherwise they are kept in RAM,
+// where NanoS only has room for a few of them
+#if defined(TARGET_NANOS) && !defined(PUBKEY_CACHE_NVM)
+#define PUBKEY_CACHE_SIZE 4
+#else
+#define PUBKEY_CACHE_SIZE 8
+#endif
+
+typedef struct {
+    uint32_t path[HDPATH_LEN_DEFAULT];
+    uint8_t pubKey[PUB_KEY_LENGTH];
+    uint8_t valid;
+} pubkey_cache_entry_t;
+
+#if defined(PUBKEY_CACHE_NVM)
+pubkey_cache_entry_t NV_CONST N_pubkey_cache_impl[PUBKEY_CACHE_SIZE] __attribute__((aligned(64)));
+#define PUBKEY_CACHE ((const pubkey_cache_entry_t *)PIC(N_pubkey_cache_impl))
+#else
+static pubkey_cache_entry_t pubkey_cache[PUBKEY_CACHE_SIZE];
+#define PUBKEY_CACHE pubkey_cache
+#endif
+
+// Entries are only written when a key is derived, the order of use is tracked in RAM
+static uint8_t pubkey_cache_age[PUBKEY_CACHE_SIZE];
+
+// Persisted entries may come from another seed (e.g. a passphrase), they are checked once per app start
+static bool pubkey_cache_checked = false;
+
+static zxerr_t crypto_derivePublicKey(const uint32_t *path, uint8_t *pubKey, uint16_t pubKeyLen) {
     if (pubKey == NULL || pubKeyLen < PUB_KEY_LENGTH) {
         return zxerr_invalid_crypto_settings;
     }
@@ -36,7 +65,7 @@ zxerr_t crypto_extractPublicKey(uint8_t *pubKey, uint16_t pubKeyLen) {
     zxerr_t error = zxerr_unknown;
 
     // Generate keys
-    CATCH_CXERROR(os_derive_bip32_with_seed_no_throw(HDW_NORMAL, CX_CURVE_Ed25519, hdPath, HDPATH_LEN_DEFAULT,
+    CATCH_CXERROR(os_derive_bip32_with_seed_no_throw(HDW_NORMAL, CX_CURVE_Ed25519, (uint32_t *)path, HDPATH_LEN_DEFAULT,
                                                      privateKeyData, NULL, NULL, 0));
 
     CATCH_CXERROR(cx_ecfp_init_private_key_no_throw(CX_CURVE_Ed25519, privateKeyData, 32, &cx_privateKey));
@@ -61,15 +90,102 @@ catch_cx_error:
     return error;
 }
 
+static void pubkey_cache_write(uint8_t slot, const pubkey_cache_entry_t *entry) {
+#if defined(PUBKEY_CACHE_NVM)
+    MEMCPY_NV((void *)&PUBKEY_CACHE[slot], (void *)entry, sizeof(pubkey_cache_entry_t));
+#else
+    MEMCPY(&PUBKEY_CACHE[slot], entry, sizeof(pubkey_cache_entry_t));
+#endif
+}
+
+static void pubkey_cache_touch(uint8_t slot) {
+    for (uint8_t i = 0; i < PUBKEY_CACHE_SIZE; i++) {
+        if (pubkey_cache_age[i] < UINT8_MAX) {
+            pubkey_cache_age[i]++;
+        }
+    }
+    pubkey_cache_age[slot] = 0;
+}
+
+static int8_t pubkey_cache_find(const uint32_t *path) {
+    for (uint8_t i = 0; i < PUBKEY_CACHE_SIZE; i++) {
+        const pubkey_cache_entry_t *entry = &PUBKEY_CACHE[i];
+        if (entry->valid && MEMCMP(entry->path, path, sizeof(entry->path)) == 0) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+// Derives the key of one entry again and drops all of them when it does not match
+static void pubkey_cache_check() {
+    if (pubkey_cache_checked) {
+        return;
+    }
+    pubkey_cache_checked = true;
+
+    for (uint8_t i = 0; i < PUBKEY_CACHE_SIZE; i++) {
+        const pubkey_cache_entry_t *entry = &PUBKEY_CACHE[i];
+        if (!entry->valid) {
+            continue;
+        }
+
+        uint8_t pubKey[PUB_KEY_LENGTH] = {0};
+        if (crypto_derivePublicKey(entry->path, pubKey, sizeof(pubKey)) == zxerr_ok &&
+            MEMCMP(pubKey, entry->pubKey, sizeof(pubKey)) == 0) {
+            return;
+        }
+
+        pubkey_cache_entry_t empty;
+        MEMZERO(&empty, sizeof(empty));
+        for (uint8_t j = 0; j < PUBKEY_CACHE_SIZE; j++) {
+            pubkey_cache_write(j, &empty);
+        }
+        return;
+    }
+}
+
+// Public key of the current hdPath, it is only derived when it is not cached
+static zxerr_t crypto_getPublicKey(uint8_t *pubKey, uint16_t pubKeyLen) {
+    pubkey_cache_check();
+
+    const int8_t found = pubkey_cache_find(hdPath);
+    if (found >= 0) {
+        MEMCPY(pubKey, PUBKEY_CACHE[found].pubKey, PUB_KEY_LENGTH);
+        pubkey_cache_touch((uint8_t)found);
+        return zxerr_ok;
+    }
+
+    CHECK_ZXERR(crypto_derivePublicKey(hdPath, pubKey, pubKeyLen))
+
+    // Replace an empty entry, or the least recently used one
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < PUBKEY_CACHE_SIZE; i++) {
+        if (!PUBKEY_CACHE[i].valid) {
+            slot = i;
+            break;
+        }
+        if (pubkey_cache_age[i] > pubkey_cache_age[slot]) {
+            slot = i;
+        }
+    }
+
+    pubkey_cache_entry_t entry;
+    MEMCPY(entry.path, hdPath, sizeof(entry.path));
+    MEMCPY(entry.pubKey, pubKey, PUB_KEY_LENGTH);
+    entry.valid = 1;
+    pubkey_cache_write(slot, &entry);
+    pubkey_cache_touch(slot);
+
+    return zxerr_ok;
+}
+
 zxerr_t crypto_sign(uint8_t *signature, uint16_t signatureMaxlen, const uint8_t *message, uint16_t messageLen,
                     tx_type_t tx_type) {
     if (signature == NULL || message == NULL || signatureMaxlen < ED25519_SIGNATURE_SIZE || messageLen == 0) {
         return zxerr_invalid_crypto_settings;
     }
 
-    cx_ecfp_private_key_t cx_privateKey;
-    uint8_t privateKeyData[SK_LEN_25519] = {0};
-
     uint8_t hash[BLAKE2B_HASH_SIZE] = {0};
     if (tx_type == tx_type_hash) {
         MEMCPY(hash, message, BLAKE2B_HASH_SIZE);
@@ -77,6 +193,17 @@ zxerr_t crypto_sign(uint8_t *signature, uint16_t signatureMaxlen, const uint8_t
         CHECK_ZXERR(blake2b_hash((uint8_t *)message, messageLen, hash))
     }
 
+    return crypto_signDigest(signature, signatureMaxlen, hash);
+}
+
+zxerr_t crypto_signDigest(uint8_t *signature, uint16_t signatureMaxlen, const uint8_t *hash) {
+    if (signature == NULL || hash == NULL || signatureMaxlen < ED25519_SIGNATURE_SIZE) {
+        return zxerr_invalid_crypto_settings;
+    }
+
+    cx_ecfp_private_key_t cx_privateKey;
+    uint8_t privateKeyData[SK_LEN_25519] = {0};
+
     zxerr_t error = zxerr_unknown;
     // Generate keys
     CATCH_CXERROR(os_derive_bip32_with_seed_no_throw(HDW_NORMAL, CX_CURVE_Ed25519, hdPath, HDPATH_LEN_DEFAULT,
@@ -101,9 +228,6 @@ catch_cx_error:
 }
 
 zxerr_t crypto_fillAddress(uint8_t *buffer, uint16_t bufferLen, uint16_t *addrResponseLen) {
-    static uint8_t address[65];
-    static uint32_t last_hdPath[HDPATH_LEN_DEFAULT] = {0};
-
     if (buffer == NULL || addrResponseLen == NULL) {
         return zxerr_out_of_bounds;
     }
@@ -116,14 +240,9 @@ zxerr_t crypto_fillAddress(uint8_t *buffer, uint16_t bufferLen, uint16_t *addrRe
 
     *addrResponseLen = 0;
 
-    // Calculate the pk only if the hd path has changed; otherwise, use the last computed pk. This avoids delays when the
-    // user reviews a transaction
-    if (MEMCMP(last_hdPath, hdPath, sizeof(uint32_t) * HDPATH_LEN_DEFAULT) != 0) {
-        CHECK_ZXERR(crypto_extractPublicKey(address, sizeof(address)))
-        MEMCPY(last_hdPath, hdPath, sizeof(uint32_t) * HDPATH_LEN_DEFAULT);
-    }
-
-    MEMCPY(buffer, address, PUB_KEY_LENGTH);
+    // The pk of recently used hd paths is cached. This avoids delays when the user reviews a transaction or
+    // switches between accounts
+    CHECK_ZXERR(crypto_getPublicKey(buffer, bufferLen))
 
     *addrResponseLen = PUB_KEY_LENGTH;
 
@@ -34,6 +34,13 @@ zxerr_t crypto_fillAddress(uint8_t *buffer, uint16_t bufferLen, uint16_t *addrRe
 zxerr_t crypto_sign(uint8_t *signature, uint16_t signatureMaxlen, const uint8_t *message, uint16_t messageLen,
                     tx_type_t tx_type);
 
+/// Sign a message that has already been hashed
+/// \param signature
+/// \param signatureMaxlen
+/// \param hash: BLAKE2B_HASH_SIZE bytes
+/// \return Error code
+zxerr_t crypto_signDigest(uint8_t *signature, uint16_t signatureMaxlen, const uint8_t *hash);
+
 #ifdef __cplusplus
 }
 #endif
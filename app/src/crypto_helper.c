@@ -17,8 +17,6 @@
 #include "crypto_helper.h"
 
 #if defined(LEDGER_SPECIFIC)
-#include "cx.h"
-
 zxerr_t blake2b_hash(const unsigned char *in, unsigned int inLen, unsigned char *out) {
     cx_blake2b_t ctx;
     if (cx_blake2b_init2_no_throw(&ctx, BLAKE2B_OUTPUT_LEN, NULL, 0, NULL, 0) != CX_OK ||
@@ -29,9 +27,29 @@ zxerr_t blake2b_hash(const unsigned char *in, unsigned int inLen, unsigned char
     return zxerr_ok;
 }
 
+zxerr_t blake2b_stream_init(blake2b_stream_t *stream) {
+    if (cx_blake2b_init2_no_throw(&stream->ctx, BLAKE2B_OUTPUT_LEN, NULL, 0, NULL, 0) != CX_OK) {
+        return zxerr_invalid_crypto_settings;
+    }
+    return zxerr_ok;
+}
+
+zxerr_t blake2b_stream_update(blake2b_stream_t *stream, const unsigned char *in, unsigned int inLen) {
+    if (cx_hash_no_throw(&stream->ctx.header, 0, in, inLen, NULL, 0) != CX_OK) {
+        return zxerr_invalid_crypto_settings;
+    }
+    return zxerr_ok;
+}
+
+zxerr_t blake2b_stream_final(blake2b_stream_t *stream, unsigned char *out) {
+    if (cx_hash_no_throw(&stream->ctx.header, CX_LAST, NULL, 0, out, BLAKE2B_HASH_SIZE) != CX_OK) {
+        return zxerr_invalid_crypto_settings;
+    }
+    return zxerr_ok;
+}
+
 #else
 
-#include "blake2.h"
 #include "hexutils.h"
 
 zxerr_t blake2b_hash(const unsigned char *in, unsigned int inLen, unsigned char *out) {
@@ -43,4 +61,25 @@ zxerr_t blake2b_hash(const unsigned char *in, unsigned int inLen, unsigned char
     }
 }
 
+zxerr_t blake2b_stream_init(blake2b_stream_t *stream) {
+    if (blake2b_init(&stream->ctx, BLAKE2B_HASH_SIZE) != 0) {
+        return zxerr_unknown;
+    }
+    return zxerr_ok;
+}
+
+zxerr_t blake2b_stream_update(blake2b_stream_t *stream, const unsigned char *in, unsigned int inLen) {
+    if (blake2b_update(&stream->ctx, in, inLen) != 0) {
+        return zxerr_unknown;
+    }
+    return zxerr_ok;
+}
+
+zxerr_t blake2b_stream_final(blake2b_stream_t *stream, unsigned char *out) {
+    if (blake2b_final(&stream->ctx, out, BLAKE2B_HASH_SIZE) != 0) {
+        return zxerr_unknown;
+    }
+    return zxerr_ok;
+}
+
 #endif
\ No newline at end of file
@@ -27,6 +27,12 @@ extern "C" {
 #include "coin.h"
 #include "zxerror.h"
 
+#if defined(LEDGER_SPECIFIC)
+#include "cx.h"
+#else
+#include "blake2.h"
+#endif
+
 #if defined(LEDGER_SPECIFIC)
 // blake2 needs to define output size in bits 512 bits = 64 bytes
 #define BLAKE2B_OUTPUT_LEN 256
@@ -38,6 +44,33 @@ extern "C" {
 
 zxerr_t blake2b_hash(const unsigned char *in, unsigned int inLen, unsigned char *out);
 
+// BLAKE2b context that absorbs its input in several calls
+typedef struct {
+#if defined(LEDGER_SPECIFIC)
+    cx_blake2b_t ctx;
+#else
+    blake2b_state ctx;
+#endif
+} blake2b_stream_t;
+
+/// Start a BLAKE2b digest of BLAKE2B_HASH_SIZE bytes
+/// \param stream
+/// \return Error code
+zxerr_t blake2b_stream_init(blake2b_stream_t *stream);
+
+/// Absorb the next part of the input
+/// \param stream
+/// \param in
+/// \param inLen
+/// \return Error code
+zxerr_t blake2b_stream_update(blake2b_stream_t *stream, const unsigned char *in, unsigned int inLen);
+
+/// Write the digest of everything absorbed so far. The stream must be started again before reuse
+/// \param stream
+/// \param out: BLAKE2B_HASH_SIZE bytes
+/// \return Error code
+zxerr_t blake2b_stream_final(blake2b_stream_t *stream, unsigned char *out);
+
 #ifdef __cplusplus
 }
 #endif
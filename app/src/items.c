@@ -22,6 +22,7 @@
 #include "crypto_helper.h"
 #include "items_format.h"
 #include "parser_impl.h"
+#include "tx.h"
 #include "zxformat.h"
 
 #define INCREMENT_NUM_ITEMS()                           \
@@ -30,6 +31,21 @@
         return items_too_many_items;                    \
     }
 
+// Transfers are summarized by sender once the clist has this many capabilities, expert mode shows them in full
+#define ITEMS_SUMMARY_MIN_CAPS 8
+
+// Summarized transfers keep their place in the clist. Each run of consecutive transfers of the same sender and
+// token starts with a From item, has one key_transfer_summary item per transfer and ends with a key_transfer_total
+// item. A group interrupted by other capabilities carries on its numbering and total in its next run.
+typedef struct {
+    bool active;
+    bool open;  // The last stored item belongs to the run below
+    uint8_t run;
+    uint8_t numOfRuns;
+    uint16_t runTransfer[ITEMS_SUMMARY_MAX_RUNS];  // First transfer of each run, names its group
+    uint8_t runCount[ITEMS_SUMMARY_MAX_RUNS];      // Transfers of the group up to the end of each run
+} items_summary_t;
+
 static items_error_t items_storeSigningTransaction();
 static items_error_t items_storeNetwork();
 static items_error_t items_storeRequiringCapabilities();
@@ -47,9 +63,10 @@ static items_error_t items_storeSignForAddr();
 static items_error_t items_storeTxItem(uint16_t transfer_token_index, uint8_t *num_of_transfers);
 static items_error_t items_storeTxCrossItem(uint16_t transfer_token_index, uint8_t *num_of_transfers);
 static items_error_t items_storeTxRotateItem(uint16_t transfer_token_index);
-static items_error_t items_storeUnknownItem(uint16_t num_of_args, uint16_t transfer_token_index);
-
-#define MAX_ITEM_LENGTH_TO_DISPLAY 256
+static items_error_t items_storeUnknownItem();
+static items_error_t items_storeTxSummaryItem(uint16_t transfer_token_index, items_summary_t *summary);
+static bool items_isSummarized(uint16_t transfer_token_index, const items_summary_t *summary);
+static items_error_t items_closeSummaryRun(items_summary_t *summary);
 
 item_array_t item_array;
 
@@ -62,10 +79,6 @@ items_error_t items_initItems() {
 
     item_array.numOfUnknownCapabilities = 1;
 
-    for (uint8_t i = 0; i < MAX_NUMBER_OF_ITEMS; i++) {
-        item_array.items[i].can_display = bool_true;
-    }
-
     return items_ok;
 }
 
@@ -117,22 +130,22 @@ static items_error_t items_storeSigningTransaction() {
     item_t *item = &item_array.items[item_array.numOfItems];
 
     item->key = key_signing;
-    item_array.toString[item_array.numOfItems] = items_signingToDisplayString;
     INCREMENT_NUM_ITEMS()
 
     return items_ok;
 }
 
 static items_error_t items_storeNetwork() {
-    uint16_t *curr_token_idx = &item_array.items[item_array.numOfItems].json_token_index;
     item_t *item = &item_array.items[item_array.numOfItems];
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    const kadena_cmd_index_t *cmd = parser_getCmdIndex();
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, *curr_token_idx, JSON_NETWORK_ID, curr_token_idx));
+    if (!CMD_HAS_FIELD(cmd, cmd_field_network_id)) {
+        return items_error;
+    }
 
-    if (!items_isNullField(*curr_token_idx)) {
+    if (!CMD_IS_NULL(cmd, cmd_field_network_id)) {
+        item->json_token_index = cmd->token[cmd_field_network_id];
         item->key = key_on_network;
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
         INCREMENT_NUM_ITEMS()
     }
 
@@ -142,25 +155,33 @@ static items_error_t items_storeNetwork() {
 static items_error_t items_storeRequiringCapabilities() {
     item_t *item = &item_array.items[item_array.numOfItems];
     item->key = key_requiring;
-    item_array.toString[item_array.numOfItems] = items_requiringToDisplayString;
     INCREMENT_NUM_ITEMS()
 
     return items_ok;
 }
 
 static items_error_t items_storeKey() {
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    uint16_t *curr_token_idx = &item_array.items[item_array.numOfItems].json_token_index;
     item_t *item = &item_array.items[item_array.numOfItems];
+    const kadena_cmd_index_t *cmd = parser_getCmdIndex();
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, *curr_token_idx, JSON_SIGNERS, curr_token_idx));
+    if (!CMD_HAS_FIELD(cmd, cmd_field_signers)) {
+        return items_error;
+    }
 
-    if (!items_isNullField(*curr_token_idx)) {
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, *curr_token_idx, 0, curr_token_idx));
-        PARSER_TO_ITEMS_ERROR(object_get_value(json_all, *curr_token_idx, JSON_PUBKEY, curr_token_idx));
-        if (!items_isNullField(*curr_token_idx)) {
+    if (!CMD_IS_NULL(cmd, cmd_field_signers)) {
+        const cmd_signer_t *signer = &cmd->signers[cmd->deviceSigner];
+        if (cmd->numberOfSigners == 0 || (signer->present & SIGNER_PUBKEY_BIT) == 0) {
+            return items_error;
+        }
+        if (cmd->deviceSignerUnknown) {
+            item->key = key_signer_unknown;
+            item->json_token_index = 0;
+            INCREMENT_NUM_ITEMS()
+            item = &item_array.items[item_array.numOfItems];
+        }
+        if ((signer->null & SIGNER_PUBKEY_BIT) == 0) {
+            item->json_token_index = signer->pubKey;
             item->key = key_of_key;
-            item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
             INCREMENT_NUM_ITEMS()
         }
     }
@@ -179,25 +200,23 @@ static items_error_t items_validateSigners() {
     if (parser_getValidClist(curr_token_idx, &clist_element_count) != parser_ok) {
         item->key = key_unscoped_signer;
         *curr_token_idx = ofKey_item->json_token_index;
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
         INCREMENT_NUM_ITEMS()
         return items_ok;
     }
 
-    uint16_t clist_token_index = *curr_token_idx;
-    PARSER_TO_ITEMS_ERROR(array_get_element_count(json_all, clist_token_index, &clist_element_count));
-
-    for (uint8_t i = 0; i < (uint8_t)clist_element_count; i++) {
-        if (array_get_nth_element(json_all, clist_token_index, i, &token_index) == parser_ok) {
-            if (parser_getTxName(token_index) == parser_name_tx_transfer) {
-                if (parser_findPubKeyInClist(ofKey_item->json_token_index) != parser_ok) {
-                    item->key = key_unscoped_signer;
-                    *curr_token_idx = ofKey_item->json_token_index;
-                    item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
-                    INCREMENT_NUM_ITEMS()
-                    return items_ok;
-                }
+    json_iter_t clist_iter;
+    PARSER_TO_ITEMS_ERROR(json_array_iter_begin(json_all, *curr_token_idx, &clist_iter));
+
+    // Transfers require the signer to be scoped, which only needs to be looked up once
+    while (json_array_iter_next(json_all, &clist_iter, &token_index) == parser_ok) {
+        if (parser_getTxName(token_index) == parser_name_tx_transfer) {
+            if (parser_isSignerScoped(parser_getCmdIndex()->deviceSigner) != parser_ok) {
+                item->key = key_unscoped_signer;
+                *curr_token_idx = ofKey_item->json_token_index;
+                INCREMENT_NUM_ITEMS()
+                return items_ok;
             }
+            break;
         }
     }
     // No transfer found
@@ -212,41 +231,50 @@ static items_error_t items_storeAllTransfers() {
     uint8_t num_of_transfers = 1;
     uint16_t clist_token_index = 0;
     uint16_t clist_element_count = 0;
-    uint16_t args_element_count = 0;
+    items_summary_t summary = {0};
 
     if (parser_getValidClist(&clist_token_index, &clist_element_count) == parser_ok) {
-        for (uint16_t i = 0; i < clist_element_count; i++) {
-            if (array_get_nth_element(json_all, clist_token_index, i, &token_index) == parser_ok) {
-                switch (parser_getTxName(token_index)) {
-                    case parser_name_tx_transfer:
-                        *curr_token_idx = token_index;
-                        items_storeTxItem(token_index, &num_of_transfers);
-                        break;
-                    case parser_name_tx_transfer_xchain:
-                        *curr_token_idx = token_index;
-                        items_storeTxCrossItem(token_index, &num_of_transfers);
-                        break;
-                    case parser_name_rotate:
-                        *curr_token_idx = token_index;
-                        items_storeTxRotateItem(token_index);
-                        break;
-                    case parser_name_gas:
-                        break;
-                    default:
-                        *curr_token_idx = token_index;
-                        PARSER_TO_ITEMS_ERROR(object_get_value(json_all, token_index, JSON_ARGS, &token_index));
-                        PARSER_TO_ITEMS_ERROR(array_get_element_count(json_all, token_index, &args_element_count));
-                        items_storeUnknownItem(args_element_count, token_index);
-                        break;
-                }
+        json_iter_t clist_iter;
+        PARSER_TO_ITEMS_ERROR(json_array_iter_begin(json_all, clist_token_index, &clist_iter));
+        summary.active = !app_mode_expert() && clist_element_count >= ITEMS_SUMMARY_MIN_CAPS;
+
+        while (json_array_iter_next(json_all, &clist_iter, &token_index) == parser_ok) {
+            const parser_error_t tx_name = parser_getTxName(token_index);
+            if (tx_name == parser_name_tx_transfer && items_isSummarized(token_index, &summary)) {
+                CHECK_ITEMS_ERROR(items_storeTxSummaryItem(token_index, &summary));
+                continue;
             }
+            if (tx_name != parser_name_gas) {
+                CHECK_ITEMS_ERROR(items_closeSummaryRun(&summary));
+            }
+
             curr_token_idx = &item_array.items[item_array.numOfItems].json_token_index;
+            switch (tx_name) {
+                case parser_name_tx_transfer:
+                    *curr_token_idx = token_index;
+                    items_storeTxItem(token_index, &num_of_transfers);
+                    break;
+                case parser_name_tx_transfer_xchain:
+                    *curr_token_idx = token_index;
+                    items_storeTxCrossItem(token_index, &num_of_transfers);
+                    break;
+                case parser_name_rotate:
+                    *curr_token_idx = token_index;
+                    items_storeTxRotateItem(token_index);
+                    break;
+                case parser_name_gas:
+                    break;
+                default:
+                    *curr_token_idx = token_index;
+                    CHECK_ITEMS_ERROR(items_storeUnknownItem());
+                    break;
+            }
         }
+        CHECK_ITEMS_ERROR(items_closeSummaryRun(&summary));
     } else {
         // Non-existing/Null Signers or Clist
         item_t *item = &item_array.items[item_array.numOfItems];
         item->key = key_warning;
-        item_array.toString[item_array.numOfItems] = items_warningToDisplayString;
         INCREMENT_NUM_ITEMS()
         *curr_token_idx = 0;
     }
@@ -257,8 +285,7 @@ static items_error_t items_storeAllTransfers() {
 static items_error_t items_storeHashWarning() {
     item_t *item = &item_array.items[item_array.numOfItems];
 
-    item->key = key_warning;
-    item_array.toString[item_array.numOfItems] = items_hashWarningToDisplayString;
+    item->key = key_hash_warning;
     INCREMENT_NUM_ITEMS()
 
     return items_ok;
@@ -268,24 +295,26 @@ static items_error_t items_storeCaution() {
     item_t *item = &item_array.items[item_array.numOfItems];
 
     item->key = key_caution;
-    item_array.toString[item_array.numOfItems] = items_cautionToDisplayString;
     INCREMENT_NUM_ITEMS()
 
     return items_ok;
 }
 
 static items_error_t items_storeChainId() {
-    uint16_t *curr_token_idx = &item_array.items[item_array.numOfItems].json_token_index;
     item_t *item = &item_array.items[item_array.numOfItems];
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    const kadena_cmd_index_t *cmd = parser_getCmdIndex();
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, 0, JSON_META, curr_token_idx));
+    if (!CMD_HAS_FIELD(cmd, cmd_field_meta)) {
+        return items_error;
+    }
 
-    if (!items_isNullField(*curr_token_idx)) {
-        PARSER_TO_ITEMS_ERROR(object_get_value(json_all, *curr_token_idx, JSON_CHAIN_ID, curr_token_idx));
-        if (!items_isNullField(*curr_token_idx)) {
+    if (!CMD_IS_NULL(cmd, cmd_field_meta)) {
+        if (!CMD_HAS_FIELD(cmd, cmd_field_chain_id)) {
+            return items_error;
+        }
+        if (!CMD_IS_NULL(cmd, cmd_field_chain_id)) {
+            item->json_token_index = cmd->token[cmd_field_chain_id];
             item->key = key_on_chain;
-            item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
             INCREMENT_NUM_ITEMS()
         }
     }
@@ -294,18 +323,19 @@ static items_error_t items_storeChainId() {
 }
 
 static items_error_t items_storeUsingGas() {
-    uint16_t *curr_token_idx = &item_array.items[item_array.numOfItems].json_token_index;
     item_t *item = &item_array.items[item_array.numOfItems];
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    const kadena_cmd_index_t *cmd = parser_getCmdIndex();
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, 0, JSON_META, curr_token_idx));
+    if (!CMD_HAS_FIELD(cmd, cmd_field_meta)) {
+        return items_error;
+    }
 
-    if (!items_isNullField(*curr_token_idx)) {
+    if (!CMD_IS_NULL(cmd, cmd_field_meta)) {
+        item->json_token_index = cmd->token[cmd_field_meta];
         item->key = key_using_gas;
-        item_array.toString[item_array.numOfItems] = items_gasToDisplayString;
         INCREMENT_NUM_ITEMS()
     } else {
-        *curr_token_idx = 0;
+        item->json_token_index = 0;
     }
 
     return items_ok;
@@ -315,9 +345,8 @@ static items_error_t items_checkTxLengths() {
     item_t *item = &item_array.items[item_array.numOfItems];
 
     for (uint8_t i = 0; i < item_array.numOfItems; i++) {
-        if (!item_array.items[i].can_display) {
-            item->key = key_warning;
-            item_array.toString[item_array.numOfItems] = items_txTooLargeToDisplayString;
+        if (!ITEM_CAN_DISPLAY(item_array.items[i])) {
+            item->key = key_tx_too_large;
             INCREMENT_NUM_ITEMS()
             return items_ok;
         }
@@ -331,8 +360,11 @@ static items_error_t items_computeHash(tx_type_t tx_type) {
         tx_hash_t *hash_obj = parser_getParserHashObj();
         base64_encode(base64_hash, 44, (uint8_t *)hash_obj->tx, hash_obj->hash_len);
     } else {
-        if (blake2b_hash((uint8_t *)parser_getParserJsonObj()->json.buffer, parser_getParserJsonObj()->json.bufferLen,
-                         hash) != zxerr_ok) {
+        const parsed_json_t *json = &parser_getParserJsonObj()->json;
+        const uint8_t *digest = tx_get_hash(json->bufferLen);
+        if (digest != NULL) {
+            MEMCPY(hash, digest, sizeof(hash));
+        } else if (blake2b_hash((const uint8_t *)json->buffer, json->bufferLen, hash) != zxerr_ok) {
             return items_error;
         }
 
@@ -355,8 +387,6 @@ static items_error_t items_storeHash() {
     item_t *item = &item_array.items[item_array.numOfItems];
 
     item->key = key_transaction_hash;
-
-    item_array.toString[item_array.numOfItems] = items_hashToDisplayString;
     INCREMENT_NUM_ITEMS()
 
     return items_ok;
@@ -367,123 +397,169 @@ static items_error_t items_storeSignForAddr() {
     item_t *item = &item_array.items[item_array.numOfItems];
 
     item->key = key_sign_for_address;
-    item_array.toString[item_array.numOfItems] = items_signForAddrToDisplayString;
     INCREMENT_NUM_ITEMS()
 #endif
     return items_ok;
 }
 
+// The arg count was already checked by parser_getTxName
 static items_error_t items_storeTxItem(uint16_t transfer_token_index, uint8_t *num_of_transfers) {
     uint16_t token_index = 0;
-    uint16_t num_of_args = 0;
     item_t *item = &item_array.items[item_array.numOfItems];
     parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, transfer_token_index, "args", &token_index));
-
-    PARSER_TO_ITEMS_ERROR(array_get_element_count(json_all, token_index, &num_of_args));
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, transfer_token_index, &json_key_args, &token_index));
 
-    if (num_of_args == 3) {
-        item->key = key_transfer;
-        (*num_of_transfers)++;
-        item_array.toString[item_array.numOfItems] = items_transferToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_from;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 0, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_to;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 1, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_amount;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 2, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_amountToDisplayString;
-        INCREMENT_NUM_ITEMS()
-    } else {
-        items_storeUnknownItem(num_of_args, token_index);
-    }
+    item->key = key_transfer;
+    item->ordinal = *num_of_transfers;
+    (*num_of_transfers)++;
+    INCREMENT_NUM_ITEMS()
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_from;
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 0, &item->json_token_index));
+    INCREMENT_NUM_ITEMS()
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_to;
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 1, &item->json_token_index));
+    INCREMENT_NUM_ITEMS()
+    // The amount points to the capability, its name gives the token to display
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_amount;
+    item->json_token_index = transfer_token_index;
+    INCREMENT_NUM_ITEMS()
 
     return items_ok;
 }
 
 static items_error_t items_storeTxCrossItem(uint16_t transfer_token_index, uint8_t *num_of_transfers) {
     uint16_t token_index = 0;
-    uint16_t num_of_args = 0;
     item_t *item = &item_array.items[item_array.numOfItems];
     parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, transfer_token_index, "args", &token_index));
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, transfer_token_index, &json_key_args, &token_index));
+
+    item->key = key_cross_transfer;
+    item->ordinal = *num_of_transfers;
+    (*num_of_transfers)++;
+    INCREMENT_NUM_ITEMS()
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_from;
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 0, &item->json_token_index));
+    INCREMENT_NUM_ITEMS()
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_to;
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 1, &item->json_token_index));
+    INCREMENT_NUM_ITEMS()
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_amount;
+    item->json_token_index = transfer_token_index;
+    INCREMENT_NUM_ITEMS()
+    item = &item_array.items[item_array.numOfItems];
+    item->key = key_to_chain;
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 3, &item->json_token_index));
+    INCREMENT_NUM_ITEMS()
+
+    return items_ok;
+}
 
-    PARSER_TO_ITEMS_ERROR(array_get_element_count(json_all, token_index, &num_of_args));
+static items_error_t items_storeTxRotateItem(__Z_UNUSED uint16_t transfer_token_index) {
+    item_t *item = &item_array.items[item_array.numOfItems];
 
-    if (num_of_args == 4) {
-        item->key = key_transfer;
-        (*num_of_transfers)++;
-        item_array.toString[item_array.numOfItems] = items_crossTransferToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_from;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 0, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_to;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 1, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_amount;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 2, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_amountToDisplayString;
-        INCREMENT_NUM_ITEMS()
-        item = &item_array.items[item_array.numOfItems];
-        item->key = key_to_chain;
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 3, &item->json_token_index));
-        item_array.toString[item_array.numOfItems] = items_stdToDisplayString;
-        INCREMENT_NUM_ITEMS()
-    } else {
-        items_storeUnknownItem(num_of_args, token_index);
-    }
+    item->key = key_rotate;
+    INCREMENT_NUM_ITEMS()
 
     return items_ok;
 }
 
-static items_error_t items_storeTxRotateItem(uint16_t transfer_token_index) {
-    uint16_t token_index = 0;
-    uint16_t num_of_args = 0;
+static bool items_continuesSummaryRun(uint16_t transfer_token_index, const items_summary_t *summary) {
+    return summary->open && parser_isSameTransferGroup(summary->runTransfer[summary->run], transfer_token_index);
+}
+
+// Transfers are summarized when their amount can be added up exactly and there is room for their run
+static bool items_isSummarized(uint16_t transfer_token_index, const items_summary_t *summary) {
+    const char *amount = NULL;
+    uint16_t amount_len = 0;
+
+    if (!summary->active || parser_getTransferAmount(transfer_token_index, &amount, &amount_len) != parser_ok) {
+        return false;
+    }
+    return items_continuesSummaryRun(transfer_token_index, summary) || summary->numOfRuns < ITEMS_SUMMARY_MAX_RUNS;
+}
+
+static items_error_t items_closeSummaryRun(items_summary_t *summary) {
     item_t *item = &item_array.items[item_array.numOfItems];
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, transfer_token_index, "args", &token_index));
+    if (!summary->open) {
+        return items_ok;
+    }
+    summary->open = false;
+
+    item->key = key_transfer_total;
+    item->ordinal = summary->run;
+    item->json_token_index = summary->runTransfer[summary->run];
+    INCREMENT_NUM_ITEMS()
 
-    PARSER_TO_ITEMS_ERROR(array_get_element_count(json_all, token_index, &num_of_args));
+    return items_ok;
+}
+
+// Add a transfer to the open run of its group, or start a new run when the previous item is anything else
+static items_error_t items_storeTxSummaryItem(uint16_t transfer_token_index, items_summary_t *summary) {
+    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    uint16_t token_index = 0;
+    const char *amount = NULL;
+    uint16_t amount_len = 0;
+
+    if (!items_continuesSummaryRun(transfer_token_index, summary)) {
+        CHECK_ITEMS_ERROR(items_closeSummaryRun(summary));
+
+        const uint8_t run = summary->numOfRuns;
+        summary->runTransfer[run] = transfer_token_index;
+        summary->runCount[run] = 0;
+        for (uint8_t i = run; i > 0; i--) {
+            if (parser_isSameTransferGroup(summary->runTransfer[i - 1], transfer_token_index)) {
+                summary->runCount[run] = summary->runCount[i - 1];
+                item_array.summaryTotals[run] = item_array.summaryTotals[i - 1];
+                break;
+            }
+        }
+        summary->run = run;
+        summary->numOfRuns++;
+        summary->open = true;
 
-    if (num_of_args == 1) {
-        item->key = key_rotate;
-        item_array.toString[item_array.numOfItems] = items_rotateToDisplayString;
+        item_t *item = &item_array.items[item_array.numOfItems];
+        PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, transfer_token_index, &json_key_args, &token_index));
+        item->key = key_from;
+        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 0, &item->json_token_index));
         INCREMENT_NUM_ITEMS()
-    } else {
-        items_storeUnknownItem(num_of_args, token_index);
     }
 
+    PARSER_TO_ITEMS_ERROR(parser_getTransferAmount(transfer_token_index, &amount, &amount_len));
+    items_amountSumAdd(&item_array.summaryTotals[summary->run], amount, amount_len);
+    summary->runCount[summary->run]++;
+
+    // Transfers are numbered within their group
+    item_t *item = &item_array.items[item_array.numOfItems];
+    item->key = key_transfer_summary;
+    item->json_token_index = transfer_token_index;
+    item->ordinal = summary->runCount[summary->run];
+    INCREMENT_NUM_ITEMS()
+
     return items_ok;
 }
 
-static items_error_t items_storeUnknownItem(uint16_t num_of_args, uint16_t transfer_token_index) {
+static items_error_t items_storeUnknownItem() {
     item_t *item = &item_array.items[item_array.numOfItems];
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    uint32_t value_len = 0;
 
     item->key = key_unknown_capability;
+    item->ordinal = item_array.numOfUnknownCapabilities;
     item_array.numOfUnknownCapabilities++;
-    item_array.toString[item_array.numOfItems] = items_unknownCapabilityToDisplayString;
 
-    if (num_of_args > 5 || json_all->tokens[transfer_token_index].end - json_all->tokens[transfer_token_index].start >
-                               MAX_ITEM_LENGTH_TO_DISPLAY) {
-        item->can_display = bool_false;
+    // Values are paged straight from the token bytes, only absurdly long ones are left out.
+    // This is the only full measure of the item, parser_validate relies on it
+    CHECK_ITEMS_ERROR(items_measure(*item, &value_len));
+    if (value_len > MAX_ITEM_LENGTH_TO_DISPLAY) {
+        item->flags |= ITEM_FLAG_NOT_DISPLAYABLE;
     }
 
     INCREMENT_NUM_ITEMS()
@@ -17,14 +17,20 @@
 
 #include <zxmacros.h>
 
+#include "parser_impl.h"
 #include "zxtypes.h"
 
 #if defined(TARGET_NANOS)
 #define MAX_NUMBER_OF_ITEMS 57
+#define ITEMS_SUMMARY_MAX_RUNS 4
 #else
 #define MAX_NUMBER_OF_ITEMS 100
+#define ITEMS_SUMMARY_MAX_RUNS 8
 #endif
 
+// Longest item value that is paged on the device
+#define MAX_ITEM_LENGTH_TO_DISPLAY 2048
+
 #define CHECK_ITEMS_ERROR(__CALL)            \
     {                                        \
         items_error_t __err = __CALL;        \
@@ -67,12 +73,28 @@ typedef enum {
     key_unknown_capability,
     key_transaction_hash,
     key_sign_for_address,
+    key_transfer_summary,
+    key_transfer_total,
+    // Same titles as above, rendered by a different formatter
+    key_hash_warning,
+    key_tx_too_large,
+    key_cross_transfer,
+    key_signer_unknown,
+    key_count,
 } display_title_t;
 
+// The value of the item is too large to be shown on the device
+#define ITEM_FLAG_NOT_DISPLAYABLE 0x01
+
+#define ITEM_CAN_DISPLAY(__item) (((__item).flags & ITEM_FLAG_NOT_DISPLAYABLE) == 0)
+
+// What to display for one review item, packed in 4 bytes.
+// The value is rendered on demand by the formatter of its key, see items_getFormatter
 typedef struct {
-    display_title_t key;
+    uint8_t key;  // display_title_t
+    uint8_t flags : 1;
+    uint8_t ordinal : 7;  // N of "Transfer N" and "Unknown Capability N" titles, set when the item is stored
     uint16_t json_token_index;
-    bool_t can_display;
 } item_t;
 
 typedef enum {
@@ -83,9 +105,30 @@ typedef enum {
     items_error,
 } items_error_t;
 
+// Destination of a formatter. Only the bytes of the value that fall in [windowStart, windowStart + outLen)
+// are copied to out, the rest are just counted in valueLen. With out == NULL the value is only measured.
+typedef struct {
+    char *out;
+    uint16_t outLen;
+    uint32_t windowStart;
+    uint32_t valueLen;
+} item_writer_t;
+
+// Renders the value of an item, a window at a time
+typedef items_error_t (*item_formatter_t)(item_t item, item_writer_t *writer);
+
+// Fixed point sum of transfer amounts, one decimal digit per byte with the point after the integer digits.
+// There is room for the sum of MAX_NUMBER_OF_ITEMS amounts of TRANSFER_AMOUNT_MAX_INT_DIGITS digits
+#define AMOUNT_SUM_INT_DIGITS (TRANSFER_AMOUNT_MAX_INT_DIGITS + 3)
+
+typedef struct {
+    uint8_t digits[AMOUNT_SUM_INT_DIGITS + TRANSFER_AMOUNT_MAX_FRAC_DIGITS];
+} amount_sum_t;
+
 typedef struct {
     item_t items[MAX_NUMBER_OF_ITEMS];
     uint8_t numOfItems;
     uint8_t numOfUnknownCapabilities;
-    items_error_t (*toString[MAX_NUMBER_OF_ITEMS])(item_t item, char *outVal, uint16_t outValLen);
+    // Total of each run of summarized transfers, added up when the items are stored. See key_transfer_total
+    amount_sum_t summaryTotals[ITEMS_SUMMARY_MAX_RUNS];
 } item_array_t;
@@ -20,296 +20,366 @@
 
 #include "common/parser.h"
 #include "crypto.h"
+#include "items.h"
 
 extern char base64_hash[45];
 
-items_error_t items_stdToDisplayString(item_t item, char *outVal, uint16_t outValLen) {
-    const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    const jsmntok_t *token = &(json_all->tokens[item.json_token_index]);
-    const uint16_t len = token->end - token->start;
+#define ARGS_NOT_DISPLAYED_TEXT "args cannot be displayed on Ledger"
+#define NO_ARGS_TEXT "no args"
 
-    if (len == 0) {
-        return items_length_zero;
-    }
+void items_writerInit(item_writer_t *writer, char *out, uint16_t outLen, uint32_t windowStart) {
+    writer->out = out;
+    writer->outLen = outLen;
+    writer->windowStart = windowStart;
+    writer->valueLen = 0;
+}
 
-    if (len >= outValLen) {
-        return items_data_too_large;
+void items_writerAppend(item_writer_t *writer, const char *data, uint16_t len) {
+    if (writer->out != NULL) {
+        // Copy the part of [valueLen, valueLen + len) that overlaps [windowStart, windowStart + outLen)
+        const uint32_t windowEnd = writer->windowStart + writer->outLen;
+        const uint32_t from = (writer->valueLen > writer->windowStart) ? writer->valueLen : writer->windowStart;
+        const uint32_t to = (writer->valueLen + len < windowEnd) ? writer->valueLen + len : windowEnd;
+        if (from < to) {
+            MEMCPY(writer->out + (from - writer->windowStart), data + (from - writer->valueLen), to - from);
+        }
     }
+    writer->valueLen += len;
+}
 
-    snprintf(outVal, outValLen, "%.*s", len, json_all->buffer + token->start);
+static void items_writerAppendText(item_writer_t *writer, const char *text) {
+    items_writerAppend(writer, text, (uint16_t)strlen(text));
+}
 
-    return items_ok;
+static void items_writerAppendNumber(item_writer_t *writer, uint32_t value) {
+    char digits[10];
+    uint8_t idx = sizeof(digits);
+    do {
+        digits[--idx] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    items_writerAppend(writer, digits + idx, sizeof(digits) - idx);
+}
+
+static void items_writerAppendToken(item_writer_t *writer, const parsed_json_t *json, uint16_t token_index) {
+    const jsmntok_t *token = json_get_token(json, token_index);
+    items_writerAppend(writer, json->buffer + JSMN_TOKEN_START(token), JSMN_TOKEN_LEN(token));
 }
 
-items_error_t items_nothingToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    char nothing[] = " ";
-    uint16_t len = 2;
+items_error_t items_stdToDisplayString(item_t item, item_writer_t *writer) {
+    const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
 
-    if (len > outValLen) {
-        return items_data_too_large;
+    if (JSMN_TOKEN_LEN(json_get_token(json_all, item.json_token_index)) == 0) {
+        return items_length_zero;
     }
 
-    snprintf(outVal, len, "%s", nothing);
+    items_writerAppendToken(writer, json_all, item.json_token_index);
     return items_ok;
 }
 
-items_error_t items_warningToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof(WARNING_TEXT);
-
-    if (len > outValLen) {
-        return items_data_too_large;
-    }
-
-    snprintf(outVal, len, WARNING_TEXT);
+items_error_t items_warningToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, WARNING_TEXT);
     return items_ok;
 }
 
-items_error_t items_hashWarningToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof(HASH_WARNING_TEXT);
+items_error_t items_hashWarningToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, HASH_WARNING_TEXT);
+    return items_ok;
+}
 
-    if (len > outValLen) {
-        return items_data_too_large;
-    }
+items_error_t items_cautionToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, CAUTION_TEXT);
+    return items_ok;
+}
 
-    snprintf(outVal, len, HASH_WARNING_TEXT);
+items_error_t items_signerUnknownToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, SIGNER_UNKNOWN_TEXT);
     return items_ok;
 }
 
-items_error_t items_cautionToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof(CAUTION_TEXT);
+items_error_t items_txTooLargeToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, TX_TOO_LARGE_TEXT);
+    return items_ok;
+}
 
-    if (len > outValLen) {
-        return items_data_too_large;
-    }
+items_error_t items_signingToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, "Transaction");
+    return items_ok;
+}
 
-    snprintf(outVal, len, CAUTION_TEXT);
+items_error_t items_requiringToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, "Capabilities");
     return items_ok;
 }
 
-items_error_t items_txTooLargeToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof(TX_TOO_LARGE_TEXT);
+// coin transfers are in KDA, fungible tokens are named after their module
+static void items_writerAppendTicker(item_writer_t *writer, uint16_t transfer_token_index) {
+    const char *module = NULL;
+    uint16_t module_len = 0;
 
-    if (len > outValLen) {
-        return items_data_too_large;
+    if (parser_getTxModule(transfer_token_index, &module, &module_len) == parser_ok) {
+        items_writerAppend(writer, module, module_len);
+        items_writerAppendText(writer, " ");
+    } else {
+        items_writerAppendText(writer, COIN_TICKER);
     }
-
-    snprintf(outVal, len, TX_TOO_LARGE_TEXT);
-    return items_ok;
 }
 
-items_error_t items_signingToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof("Transaction");
-
-    if (len > outValLen) {
-        return items_data_too_large;
+// The amount must have passed parser_getTransferAmount
+void items_amountSumAdd(amount_sum_t *sum, const char *amount, uint16_t amount_len) {
+    uint16_t int_digits = 0;
+    while (int_digits < amount_len && amount[int_digits] != '.') {
+        int_digits++;
     }
 
-    snprintf(outVal, len, "Transaction");
-    return items_ok;
+    uint8_t carry = 0;
+    for (int16_t pos = (int16_t)sizeof(sum->digits) - 1; pos >= 0; pos--) {
+        // Offset of the digit in amount, the point is skipped
+        const int32_t offset = (pos < AMOUNT_SUM_INT_DIGITS) ? (int32_t)int_digits - AMOUNT_SUM_INT_DIGITS + pos
+                                                             : (int32_t)int_digits + 1 + pos - AMOUNT_SUM_INT_DIGITS;
+        uint8_t digit = carry;
+        if (offset >= 0 && offset < amount_len && (pos < AMOUNT_SUM_INT_DIGITS || offset > int_digits)) {
+            digit += (uint8_t)(amount[offset] - '0');
+        }
+        digit += sum->digits[pos];
+        sum->digits[pos] = digit % 10;
+        carry = digit / 10;
+    }
 }
 
-items_error_t items_requiringToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof("Capabilities");
+static void items_writerAppendAmountSum(item_writer_t *writer, const amount_sum_t *sum) {
+    char text[sizeof(sum->digits) + 1];
+    uint16_t len = 0;
 
-    if (len > outValLen) {
-        return items_data_too_large;
+    uint8_t first = 0;
+    while (first < AMOUNT_SUM_INT_DIGITS - 1 && sum->digits[first] == 0) {
+        first++;
+    }
+    uint8_t last = sizeof(sum->digits);
+    while (last > AMOUNT_SUM_INT_DIGITS && sum->digits[last - 1] == 0) {
+        last--;
     }
 
-    snprintf(outVal, len, "Capabilities");
-    return items_ok;
+    for (uint8_t pos = first; pos < last; pos++) {
+        if (pos == AMOUNT_SUM_INT_DIGITS) {
+            text[len++] = '.';
+        }
+        text[len++] = (char)('0' + sum->digits[pos]);
+    }
+    items_writerAppend(writer, text, len);
 }
 
-items_error_t items_amountToDisplayString(item_t item, char *outVal, uint16_t outValLen) {
+items_error_t items_amountToDisplayString(item_t item, item_writer_t *writer) {
+    uint16_t token_index = 0;
     const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    const jsmntok_t *token = &(json_all->tokens[item.json_token_index]);
-    const uint16_t len = token->end - token->start;
 
-    if (len == 0) {
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, item.json_token_index, &json_key_args, &token_index));
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 2, &token_index));
+    if (JSMN_TOKEN_LEN(json_get_token(json_all, token_index)) == 0) {
         return items_length_zero;
     }
 
-    if (len >= outValLen) {
-        return items_data_too_large;
-    }
-
-    snprintf(outVal, outValLen, "KDA %.*s", len, json_all->buffer + token->start);
-
+    items_writerAppendTicker(writer, item.json_token_index);
+    items_writerAppendToken(writer, json_all, token_index);
     return items_ok;
 }
 
-items_error_t items_transferToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof("Normal Transfer");
+items_error_t items_transferSummaryToDisplayString(item_t item, item_writer_t *writer) {
+    uint16_t token_index = 0;
+    const char *amount = NULL;
+    uint16_t amount_len = 0;
+    const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
 
-    if (len > outValLen) {
-        return items_data_too_large;
-    }
+    PARSER_TO_ITEMS_ERROR(parser_getTransferAmount(item.json_token_index, &amount, &amount_len));
+    items_writerAppendTicker(writer, item.json_token_index);
+    items_writerAppend(writer, amount, amount_len);
 
-    snprintf(outVal, len, "Normal Transfer");
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, item.json_token_index, &json_key_args, &token_index));
+    PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 1, &token_index));
+    items_writerAppendText(writer, " to ");
+    items_writerAppendToken(writer, json_all, token_index);
     return items_ok;
 }
 
-items_error_t items_crossTransferToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    uint16_t len = sizeof("Cross-chain Transfer");
+items_error_t items_transferTotalToDisplayString(item_t item, item_writer_t *writer) {
+    const item_array_t *item_array = items_getItemArray();
 
-    if (len > outValLen) {
-        return items_data_too_large;
+    if (item.ordinal >= ITEMS_SUMMARY_MAX_RUNS) {
+        return items_error;
     }
+    items_writerAppendTicker(writer, item.json_token_index);
+    items_writerAppendAmountSum(writer, &item_array->summaryTotals[item.ordinal]);
+    return items_ok;
+}
+
+items_error_t items_transferToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, "Normal Transfer");
+    return items_ok;
+}
 
-    snprintf(outVal, len, "Cross-chain Transfer");
+items_error_t items_crossTransferToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    items_writerAppendText(writer, "Cross-chain Transfer");
     return items_ok;
 }
 
-items_error_t items_rotateToDisplayString(item_t item, char *outVal, uint16_t outValLen) {
+items_error_t items_rotateToDisplayString(item_t item, item_writer_t *writer) {
     uint16_t token_index = 0;
-    uint16_t item_token_index = item.json_token_index;
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    jsmntok_t *token = NULL;
+    const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, item_token_index, "args", &token_index));
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, item.json_token_index, &json_key_args, &token_index));
     PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, 0, &token_index));
-    token = &(json_all->tokens[token_index]);
-
-    outValLen = token->end - token->start + sizeof("\"\"");
-    snprintf(outVal, outValLen, "\"%s\"", json_all->buffer + token->start);
 
+    items_writerAppendText(writer, "\"");
+    items_writerAppendToken(writer, json_all, token_index);
+    items_writerAppendText(writer, "\"");
     return items_ok;
 }
 
-items_error_t items_gasToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
-    const char *gasLimit = NULL;
-    const char *gasPrice = NULL;
-    uint8_t gasLimit_len = 0;
-    uint8_t gasPrice_len = 0;
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    uint16_t item_token_index = item.json_token_index;
-    uint16_t meta_token_index = item.json_token_index;
-    jsmntok_t *token = NULL;
-
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, item_token_index, JSON_GAS_LIMIT, &item_token_index));
-    token = &(json_all->tokens[item_token_index]);
-    gasLimit = json_all->buffer + token->start;
-    gasLimit_len = token->end - token->start;
-
-    item_token_index = meta_token_index;
-
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, item_token_index, JSON_GAS_PRICE, &item_token_index));
-    token = &(json_all->tokens[item_token_index]);
-    gasPrice = json_all->buffer + token->start;
-    gasPrice_len = token->end - token->start;
-
-    uint16_t required_len = gasLimit_len + gasPrice_len + strlen("at most ") + strlen(" at price ");
-    if (required_len > outValLen) {
-        return items_data_too_large;
-    }
+items_error_t items_gasToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
+    const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    const kadena_cmd_index_t *cmd = parser_getCmdIndex();
 
-    snprintf(outVal, outValLen, "at most %.*s at price %.*s", gasLimit_len, gasLimit, gasPrice_len, gasPrice);
+    if (!CMD_HAS_FIELD(cmd, cmd_field_gas_limit) || !CMD_HAS_FIELD(cmd, cmd_field_gas_price)) {
+        return items_error;
+    }
 
+    items_writerAppendText(writer, "at most ");
+    items_writerAppendToken(writer, json_all, cmd->token[cmd_field_gas_limit]);
+    items_writerAppendText(writer, " at price ");
+    items_writerAppendToken(writer, json_all, cmd->token[cmd_field_gas_price]);
     return items_ok;
 }
 
-items_error_t items_hashToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
+items_error_t items_hashToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
     // TODO: why -2 here?
-    uint16_t len = sizeof(base64_hash) - 2;
-    if (len >= outValLen) {
-        return items_data_too_large;
-    }
-
-    snprintf(outVal, outValLen, "%.*s", len, base64_hash);
+    items_writerAppend(writer, base64_hash, (uint16_t)strnlen(base64_hash, sizeof(base64_hash) - 2));
     return items_ok;
 }
 
-items_error_t items_unknownCapabilityToDisplayString(item_t item, char *outVal, uint16_t outValLen) {
+items_error_t items_unknownCapabilityToDisplayString(item_t item, item_writer_t *writer) {
     uint16_t token_index = 0;
     uint16_t args_count = 0;
-    uint8_t outVal_idx = 0;
-    parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    uint16_t item_token_index = item.json_token_index;
-    jsmntok_t *token = NULL;
-    uint16_t len = 0;
-
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, item_token_index, JSON_NAME, &token_index));
-    token = &(json_all->tokens[token_index]);
-
-    len = token->end - token->start;
+    const parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
+    const jsmntok_t *token = NULL;
 
-    if (len == 0) {
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, item.json_token_index, &json_key_name, &token_index));
+    if (JSMN_TOKEN_LEN(json_get_token(json_all, token_index)) == 0) {
         return items_length_zero;
     }
 
-    if (len >= outValLen) {
-        return items_data_too_large;
-    }
-
-    snprintf(outVal, outValLen, "name: %.*s, ]}],\"", len, json_all->buffer + token->start);
-
-    // outVal_idx is after the , of %.*s
-    outVal_idx = sizeof("name: ") + len + 1;
-
-    if (item.can_display == bool_false) {
-        const char *msg = "args cannot be displayed on Ledger";
-        uint16_t len_msg = strlen(msg);
-
-        if (outVal_idx + len_msg >= outValLen) {
-            return items_data_too_large;
-        }
+    items_writerAppendText(writer, "name: ");
+    items_writerAppendToken(writer, json_all, token_index);
+    items_writerAppendText(writer, ", ");
 
-        snprintf(outVal + outVal_idx, len_msg + 1, "%s", msg);
+    if (!ITEM_CAN_DISPLAY(item)) {
+        items_writerAppendText(writer, ARGS_NOT_DISPLAYED_TEXT);
         return items_ok;
     }
 
-    PARSER_TO_ITEMS_ERROR(object_get_value(json_all, item_token_index, "args", &token_index));
-    PARSER_TO_ITEMS_ERROR(array_get_element_count(json_all, token_index, &args_count));
+    json_iter_t args_iter;
+    uint16_t args_token_index = 0;
+    PARSER_TO_ITEMS_ERROR(object_get_value_by_key(json_all, item.json_token_index, &json_key_args, &token_index));
+    PARSER_TO_ITEMS_ERROR(json_array_iter_begin(json_all, token_index, &args_iter));
 
-    if (args_count) {
-        uint16_t args_token_index = 0;
-        for (uint8_t i = 0; i < (uint8_t)args_count - 1; i++) {
-            PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, i, &args_token_index));
-            token = &(json_all->tokens[args_token_index]);
+    while (json_array_iter_next(json_all, &args_iter, &args_token_index) == parser_ok) {
+        token = json_get_token(json_all, args_token_index);
+        const bool quoted = (JSMN_TOKEN_TYPE(token) == JSMN_STRING);
+        args_count++;
 
-            len = token->end - token->start + (token->type == JSMN_STRING ? sizeof("arg X: \"\",") : sizeof("arg X: ,"));
-
-            // Strings go in between double quotes
-            snprintf(outVal + outVal_idx, len, (token->type == JSMN_STRING) ? "arg %d: \"%s\"," : "arg %d: %s,", i + 1,
-                     json_all->buffer + token->start);
-
-            outVal_idx += len;
-            outVal[outVal_idx - 1] = ' ';  // Remove null terminator
+        // Every arg but the first is separated from the previous one
+        if (args_count > 1) {
+            items_writerAppendText(writer, ", ");
         }
-
-        // Last arg (without comma)
-        PARSER_TO_ITEMS_ERROR(array_get_nth_element(json_all, token_index, args_count - 1, &args_token_index));
-        token = &(json_all->tokens[args_token_index]);
-
-        len = token->end - token->start + (token->type == JSMN_STRING ? sizeof("arg X: \"\"") : sizeof("arg X: "));
-
-        snprintf(outVal + outVal_idx, len, (token->type == JSMN_STRING) ? "arg %d: \"%s\"" : "arg %d: %s", args_count,
-                 json_all->buffer + token->start);
-    } else {
-        const char *msg = "no args";
-        uint16_t len_msg = strlen(msg);
-
-        if (outVal_idx + len_msg >= outValLen) {
-            return items_data_too_large;
+        items_writerAppendText(writer, "arg ");
+        items_writerAppendNumber(writer, args_count);
+        items_writerAppendText(writer, quoted ? ": \"" : ": ");
+        items_writerAppendToken(writer, json_all, args_token_index);
+        if (quoted) {
+            items_writerAppendText(writer, "\"");
         }
+    }
 
-        snprintf(outVal + outVal_idx, len + 1, "%s", msg);
+    if (args_count == 0) {
+        items_writerAppendText(writer, NO_ARGS_TEXT);
     }
 
     return items_ok;
 }
 
 #if defined(LEDGER_SPECIFIC)
-items_error_t items_signForAddrToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen) {
+items_error_t items_signForAddrToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer) {
     uint8_t address[65];
+    char address_hex[2 * PUB_KEY_LENGTH + 1];
     uint16_t address_len = 0;
 
+    // Measuring does not need the key to be derived
+    if (writer->out == NULL) {
+        items_writerAppend(writer, NULL, 2 * PUB_KEY_LENGTH);
+        return items_ok;
+    }
+
     if (crypto_fillAddress(address, sizeof(address), &address_len) != zxerr_ok) {
         return items_error;
     }
 
-    outValLen = sizeof(address);
-    array_to_hexstr(outVal, outValLen, address, PUB_KEY_LENGTH);
+    array_to_hexstr(address_hex, sizeof(address_hex), address, PUB_KEY_LENGTH);
+    items_writerAppend(writer, address_hex, 2 * PUB_KEY_LENGTH);
+
+    return items_ok;
+}
+#endif
+
+// Formatter of each display_title_t, keys that are never stored have none
+static const item_formatter_t items_formatters[key_count] = {
+    [key_signing] = items_signingToDisplayString,
+    [key_on_network] = items_stdToDisplayString,
+    [key_requiring] = items_requiringToDisplayString,
+    [key_of_key] = items_stdToDisplayString,
+    [key_unscoped_signer] = items_stdToDisplayString,
+    [key_warning] = items_warningToDisplayString,
+    [key_caution] = items_cautionToDisplayString,
+    [key_on_chain] = items_stdToDisplayString,
+    [key_using_gas] = items_gasToDisplayString,
+    [key_transfer] = items_transferToDisplayString,
+    [key_from] = items_stdToDisplayString,
+    [key_to] = items_stdToDisplayString,
+    [key_amount] = items_amountToDisplayString,
+    [key_to_chain] = items_stdToDisplayString,
+    [key_rotate] = items_rotateToDisplayString,
+    [key_unknown_capability] = items_unknownCapabilityToDisplayString,
+    [key_transaction_hash] = items_hashToDisplayString,
+#if defined(LEDGER_SPECIFIC)
+    [key_sign_for_address] = items_signForAddrToDisplayString,
+#endif
+    [key_hash_warning] = items_hashWarningToDisplayString,
+    [key_tx_too_large] = items_txTooLargeToDisplayString,
+    [key_cross_transfer] = items_crossTransferToDisplayString,
+    [key_transfer_summary] = items_transferSummaryToDisplayString,
+    [key_transfer_total] = items_transferTotalToDisplayString,
+    [key_signer_unknown] = items_signerUnknownToDisplayString,
+};
+
+item_formatter_t items_getFormatter(uint8_t key) {
+    if (key >= key_count) {
+        return NULL;
+    }
+
+    const item_formatter_t *formatter = (const item_formatter_t *)PIC(&items_formatters[key]);
+    if (*formatter == NULL) {
+        return NULL;
+    }
+    return (item_formatter_t)PIC(*formatter);
+}
+
+items_error_t items_measure(item_t item, uint32_t *valueLen) {
+    const item_formatter_t formatter = items_getFormatter(item.key);
+    if (formatter == NULL) {
+        return items_error;
+    }
 
+    item_writer_t writer;
+    items_writerInit(&writer, NULL, 0, 0);
+    CHECK_ITEMS_ERROR(formatter(item, &writer));
+    *valueLen = writer.valueLen;
     return items_ok;
 }
-#endif
\ No newline at end of file
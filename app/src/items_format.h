@@ -26,24 +26,58 @@
 #define HASH_WARNING_TEXT \
     "Blind Signing a Transaction Hash is a very unusual operation. Do not continue unless you know what you are doing"
 #define CAUTION_TEXT "'meta' field of transaction not recognized"
+#define SIGNER_UNKNOWN_TEXT \
+    "None of the signers is the key of this device. The key and capabilities shown belong to the first signer"
 #define TX_TOO_LARGE_TEXT \
     "Transaction too large for Ledger to display.  PROCEED WITH GREAT CAUTION.  Do you want to continue?"
 
-items_error_t items_stdToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_nothingToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_warningToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_hashWarningToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_cautionToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_txTooLargeToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_signingToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_requiringToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_amountToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_transferToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_crossTransferToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_rotateToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_gasToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_hashToDisplayString(item_t item, char *outVal, uint16_t outValLen);
-items_error_t items_unknownCapabilityToDisplayString(item_t item, char *outVal, uint16_t outValLen);
+/// Start writing a value
+/// \param writer
+/// \param out: destination of the window, NULL to only measure the value
+/// \param outLen: size of the window
+/// \param windowStart: offset in the value of the first byte written to out
+void items_writerInit(item_writer_t *writer, char *out, uint16_t outLen, uint32_t windowStart);
+
+/// Append bytes to the value, copying those that fall in the window
+/// \param writer
+/// \param data
+/// \param len
+void items_writerAppend(item_writer_t *writer, const char *data, uint16_t len);
+
+/// Add a transfer amount to a sum
+/// \param sum
+/// \param amount: a plain decimal accepted by parser_getTransferAmount
+/// \param amount_len
+void items_amountSumAdd(amount_sum_t *sum, const char *amount, uint16_t amount_len);
+
+items_error_t items_stdToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_warningToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer);
+items_error_t items_hashWarningToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer);
+items_error_t items_cautionToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer);
+items_error_t items_txTooLargeToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer);
+items_error_t items_signerUnknownToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer);
+items_error_t items_signingToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_requiringToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_amountToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_transferToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_crossTransferToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_transferSummaryToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_transferTotalToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_rotateToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_gasToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_hashToDisplayString(item_t item, item_writer_t *writer);
+items_error_t items_unknownCapabilityToDisplayString(item_t item, item_writer_t *writer);
 #if defined(LEDGER_SPECIFIC)
-items_error_t items_signForAddrToDisplayString(__Z_UNUSED item_t item, char *outVal, uint16_t outValLen);
+items_error_t items_signForAddrToDisplayString(__Z_UNUSED item_t item, item_writer_t *writer);
 #endif
+
+/// Get the formatter of a display title
+/// \param key: display_title_t of the item
+/// \return formatter, NULL when the key has none
+item_formatter_t items_getFormatter(uint8_t key);
+
+/// Get the length of the value of an item without rendering it
+/// \param item
+/// \param valueLen (out)
+/// \return Error message
+items_error_t items_measure(item_t item, uint32_t *valueLen);
@@ -23,16 +23,119 @@
  */
 
 #include "jsmn.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) && !defined(JSMN_NO_SIMD)
+#include <emmintrin.h>
+#define JSMN_SIMD_SSE2
+#endif
+
+/**
+ * Word-at-a-time (SWAR) helpers used to skip over the bytes that cannot end a
+ * string or a primitive. They only tell whether a word may contain such a byte;
+ * the byte loops still decide what to do with it, so tokens are unchanged.
+ */
+typedef uint32_t jsmn_word_t;
+
+#define JSMN_WORD_ONES ((jsmn_word_t)0x01010101u)
+#define JSMN_WORD_HIGHS ((jsmn_word_t)0x80808080u)
+/* Some byte of x is zero */
+#define JSMN_WORD_HAS_ZERO(x) (((x) - JSMN_WORD_ONES) & ~(x) & JSMN_WORD_HIGHS)
+/* Some byte of x is equal to b */
+#define JSMN_WORD_HAS_BYTE(x, b) JSMN_WORD_HAS_ZERO((x) ^ (JSMN_WORD_ONES * (jsmn_word_t)(b)))
+/* Some byte of x is lower than n, 0 <= n <= 128 */
+#define JSMN_WORD_HAS_LESS(x, n) (((x) - JSMN_WORD_ONES * (jsmn_word_t)(n)) & ~(x) & JSMN_WORD_HIGHS)
+/* Some byte of x is greater than n, 0 <= n <= 127 */
+#define JSMN_WORD_HAS_MORE(x, n) ((((x) + JSMN_WORD_ONES * (jsmn_word_t)(127 - (n))) | (x)) & JSMN_WORD_HIGHS)
+
+static jsmn_word_t jsmn_load_word(const char *js) {
+    jsmn_word_t word = 0;
+    memcpy(&word, js, sizeof(word));
+    return word;
+}
+
+/**
+ * Returns the position of the first byte from pos that may be a quote, a
+ * backslash or a NUL, or the position where less than a word is left.
+ */
+static size_t jsmn_skip_string_bytes(const char *js, size_t pos, const size_t len) {
+#ifdef JSMN_SIMD_SSE2
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+    for (; pos + sizeof(__m128i) <= len; pos += sizeof(__m128i)) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(js + pos));
+        const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                         _mm_cmpeq_epi8(v, zero));
+        const int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return pos + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+    }
+#endif
+    for (; pos + sizeof(jsmn_word_t) <= len; pos += sizeof(jsmn_word_t)) {
+        const jsmn_word_t word = jsmn_load_word(js + pos);
+        if (JSMN_WORD_HAS_BYTE(word, '\"') | JSMN_WORD_HAS_BYTE(word, '\\') | JSMN_WORD_HAS_ZERO(word)) {
+            break;
+        }
+    }
+    return pos;
+}
+
+/**
+ * Returns the position of the first byte from pos that may end a primitive
+ * (delimiter, control, non-ASCII or NUL), or the position where less than a
+ * word is left.
+ */
+static size_t jsmn_skip_primitive_bytes(const char *js, size_t pos, const size_t len) {
+#ifdef JSMN_SIMD_SSE2
+    for (; pos + sizeof(__m128i) <= len; pos += sizeof(__m128i)) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(js + pos));
+        /* Signed compares: bytes >= 128 are negative and also caught by the first one */
+        __m128i hit = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(33)), _mm_cmpgt_epi8(v, _mm_set1_epi8(126)));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(']')));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+        const int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return pos + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+    }
+#endif
+    for (; pos + sizeof(jsmn_word_t) <= len; pos += sizeof(jsmn_word_t)) {
+        const jsmn_word_t word = jsmn_load_word(js + pos);
+        if (JSMN_WORD_HAS_LESS(word, 33) | JSMN_WORD_HAS_MORE(word, 126) | JSMN_WORD_HAS_BYTE(word, ':') |
+            JSMN_WORD_HAS_BYTE(word, ',') | JSMN_WORD_HAS_BYTE(word, ']') | JSMN_WORD_HAS_BYTE(word, '}')) {
+            break;
+        }
+    }
+    return pos;
+}
+
+/**
+ * Returns token i, tokens past the caller's array continue in the spill array.
+ */
+static jsmntok_t *jsmn_token_at(const jsmn_parser *parser, jsmntok_t *tokens, const unsigned int i) {
+    if (i < parser->tokens_len) {
+        return &tokens[i];
+    }
+    return &parser->spill[i - parser->tokens_len];
+}
+
 /**
  * Allocates a fresh unused token from the token pool.
  */
 static jsmntok_t *jsmn_alloc_token(jsmn_parser *parser, jsmntok_t *tokens, const size_t num_tokens) {
     jsmntok_t *tok = NULL;
-    if (parser->toknext >= num_tokens) {
+    if (parser->toknext >= num_tokens + parser->spill_len) {
         return NULL;
     }
-    tok = &tokens[parser->toknext++];
-    tok->start = tok->end = 0xFFFF;
+    tok = jsmn_token_at(parser, tokens, parser->toknext++);
+    tok->start_type = 0;
+    tok->end = 0xFFFF;
 #ifdef JSMN_PARENT_LINKS
     tok->parent = 0xFFFF;
 #endif
@@ -42,9 +145,22 @@ static jsmntok_t *jsmn_alloc_token(jsmn_parser *parser, jsmntok_t *tokens, const
 /**
  * Fills token type and boundaries.
  */
-static void jsmn_fill_token(jsmntok_t *token, const jsmntype_t type, const int start, const int end) {
-    token->type = type;
-    token->start = start;
+JSMN_API void jsmn_fill_token(jsmntok_t *token, const jsmntype_t type, const int start, const int end) {
+    unsigned short code = 0;
+    switch (type) {
+        case JSMN_ARRAY:
+            code = 1;
+            break;
+        case JSMN_STRING:
+            code = 2;
+            break;
+        case JSMN_PRIMITIVE:
+            code = 3;
+            break;
+        default:
+            break;
+    }
+    token->start_type = (unsigned short)((start & JSMN_MAX_OFFSET) | (code << JSMN_TYPE_SHIFT));
     token->end = end;
 }
 
@@ -58,6 +174,9 @@ static int jsmn_parse_primitive(jsmn_parser *parser, const char *js, const size_
 
     start = parser->pos;
 
+    /* Only the bytes found by the skip can end the primitive, the loop below handles them */
+    parser->pos = jsmn_skip_primitive_bytes(js, parser->pos, len);
+
     for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
         switch (js[parser->pos]) {
 #ifndef JSMN_STRICT
@@ -86,6 +205,11 @@ static int jsmn_parse_primitive(jsmn_parser *parser, const char *js, const size_
     parser->pos = start;
     return JSMN_ERROR_PART;
 #endif
+    /* The primitive may continue in the next chunk */
+    if (parser->streaming && parser->pos >= len) {
+        parser->pos = start;
+        return JSMN_ERROR_PART;
+    }
 
 found:
     if (tokens == NULL) {
@@ -118,6 +242,12 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js, const size_t l
     parser->pos++;
 
     for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
+        /* Jump to the next byte that may end the string or start an escape */
+        parser->pos = jsmn_skip_string_bytes(js, parser->pos, len);
+        if (parser->pos >= len || js[parser->pos] == '\0') {
+            break;
+        }
+
         char c = js[parser->pos];
 
         /* Quote: end of string */
@@ -178,6 +308,94 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js, const size_t l
     return JSMN_ERROR_PART;
 }
 
+/**
+ * Points toksuper to the innermost container that is still open.
+ */
+static void jsmn_update_toksuper(jsmn_parser *parser, jsmntok_t *tokens) {
+    int i = 0;
+    parser->toksuper = -1;
+    for (i = parser->toknext - 1; i >= 0; i--) {
+        const jsmntok_t *token = jsmn_token_at(parser, tokens, i);
+        if ((JSMN_TOKEN_TYPE(token) == JSMN_ARRAY || JSMN_TOKEN_TYPE(token) == JSMN_OBJECT) && token->end == 0xFFFF) {
+            parser->toksuper = i;
+            return;
+        }
+    }
+}
+
+/**
+ * Whether the container being opened is the value of a key the caller wants
+ * to keep opaque.
+ */
+static int jsmn_is_opaque(const jsmn_parser *parser, const char *js, jsmntok_t *tokens) {
+    if (parser->opaque == NULL || parser->toksuper < 0) {
+        return 0;
+    }
+    const jsmntok_t *key = jsmn_token_at(parser, tokens, parser->toksuper);
+    if (JSMN_TOKEN_TYPE(key) != JSMN_STRING) {
+        return 0;
+    }
+    return parser->opaque(parser->opaque_ctx, js + JSMN_TOKEN_START(key), JSMN_TOKEN_LEN(key), parser->depth);
+}
+
+/**
+ * Skips the contents of an opaque value, only checking that brackets match and
+ * strings are closed. The state is kept in the parser so the skip can resume
+ * when more input arrives. On completion the value's token (the last one) is
+ * closed and parser->pos points to its closing bracket.
+ */
+static int jsmn_skip_opaque(jsmn_parser *parser, const char *js, const size_t len, jsmntok_t *tokens) {
+    for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
+        if (parser->skip_string != 0) {
+            if (parser->skip_string == 2) {
+                parser->skip_string = 1;
+                continue;
+            }
+            parser->pos = jsmn_skip_string_bytes(js, parser->pos, len);
+            if (parser->pos >= len || js[parser->pos] == '\0') {
+                break;
+            }
+            if (js[parser->pos] == '\\') {
+                parser->skip_string = 2;
+            } else if (js[parser->pos] == '\"') {
+                parser->skip_string = 0;
+            }
+            continue;
+        }
+
+        const char c = js[parser->pos];
+        switch (c) {
+            case '\"':
+                parser->skip_string = 1;
+                break;
+            case '{':
+            case '[':
+                if (parser->skip_depth >= JSMN_MAX_OPAQUE_DEPTH) {
+                    return JSMN_ERROR_INVAL;
+                }
+                parser->skip_types = (parser->skip_types << 1) | (c == '[' ? 1u : 0u);
+                parser->skip_depth++;
+                break;
+            case '}':
+            case ']':
+                if ((parser->skip_types & 1u) != (c == ']' ? 1u : 0u)) {
+                    return JSMN_ERROR_INVAL;
+                }
+                parser->skip_types >>= 1;
+                parser->skip_depth--;
+                if (parser->skip_depth == 0) {
+                    jsmn_token_at(parser, tokens, parser->toknext - 1)->end = parser->pos + 1;
+                    jsmn_update_toksuper(parser, tokens);
+                    return 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return JSMN_ERROR_PART;
+}
+
 /**
  * Parse JSON string and fill tokens.
  */
@@ -188,6 +406,17 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
     jsmntok_t *token = NULL;
     int count = parser->toknext;
 
+    parser->tokens_len = num_tokens;
+
+    /* Resume an opaque value cut at the end of the previous chunk */
+    if (tokens != NULL && parser->skip_depth > 0) {
+        r = jsmn_skip_opaque(parser, js, len, tokens);
+        if (r < 0) {
+            return r;
+        }
+        parser->pos++;
+    }
+
     for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
         char c = 0;
         jsmntype_t type = JSMN_UNDEFINED;
@@ -204,11 +433,11 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
                 if (token == NULL) {
                     return JSMN_ERROR_NOMEM;
                 }
-                if (parser->toksuper != 0xFFFF) {
+                if (parser->toksuper != -1) {
 #ifdef JSMN_STRICT
                     /* In strict mode an object or array can't become a key */
-                    jsmntok_t *t = &tokens[parser->toksuper];
-                    if (t->type == JSMN_OBJECT) {
+                    jsmntok_t *t = jsmn_token_at(parser, tokens, parser->toksuper);
+                    if (JSMN_TOKEN_TYPE(t) == JSMN_OBJECT) {
                         return JSMN_ERROR_INVAL;
                     }
 #endif
@@ -216,8 +445,22 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
                     token->parent = parser->toksuper;
 #endif
                 }
-                token->type = (c == '{' ? JSMN_OBJECT : JSMN_ARRAY);
-                token->start = parser->pos;
+                jsmn_fill_token(token, (c == '{' ? JSMN_OBJECT : JSMN_ARRAY), parser->pos, 0xFFFF);
+                if (jsmn_is_opaque(parser, js, tokens)) {
+                    parser->skip_depth = 1;
+                    parser->skip_types = (c == '[') ? 1u : 0u;
+                    parser->skip_string = 0;
+                    parser->pos++;
+                    r = jsmn_skip_opaque(parser, js, len, tokens);
+                    if (r < 0) {
+                        return r;
+                    }
+                    break;
+                }
+                parser->depth++;
+                if (parser->depth > parser->max_depth) {
+                    parser->max_depth = parser->depth;
+                }
                 parser->toksuper = parser->toknext - 1;
                 break;
             case '}':
@@ -230,33 +473,39 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
                 if (parser->toknext < 1) {
                     return JSMN_ERROR_INVAL;
                 }
-                token = &tokens[parser->toknext - 1];
+                token = jsmn_token_at(parser, tokens, parser->toknext - 1);
                 for (;;) {
-                    if (token->start != 0xFFFF && token->end == 0xFFFF) {
-                        if (token->type != type) {
+                    if (token->end == 0xFFFF) {
+                        if (JSMN_TOKEN_TYPE(token) != type) {
                             return JSMN_ERROR_INVAL;
                         }
                         token->end = parser->pos + 1;
                         parser->toksuper = token->parent;
+                        if (parser->depth > 0) {
+                            parser->depth--;
+                        }
                         break;
                     }
                     if (token->parent == 0xFFFF) {
-                        if (token->type != type || parser->toksuper == 0xFFFF) {
+                        if (JSMN_TOKEN_TYPE(token) != type || parser->toksuper == 0xFFFF) {
                             return JSMN_ERROR_INVAL;
                         }
                         break;
                     }
-                    token = &tokens[token->parent];
+                    token = jsmn_token_at(parser, tokens, token->parent);
                 }
 #else
                 for (i = parser->toknext - 1; i >= 0; i--) {
-                    token = &tokens[i];
-                    if (token->start != 0xFFFF && token->end == 0xFFFF) {
-                        if (token->type != type) {
+                    token = jsmn_token_at(parser, tokens, i);
+                    if (token->end == 0xFFFF) {
+                        if (JSMN_TOKEN_TYPE(token) != type) {
                             return JSMN_ERROR_INVAL;
                         }
                         parser->toksuper = -1;
                         token->end = parser->pos + 1;
+                        if (parser->depth > 0) {
+                            parser->depth--;
+                        }
                         break;
                     }
                 }
@@ -265,8 +514,8 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
                     return JSMN_ERROR_INVAL;
                 }
                 for (; i >= 0; i--) {
-                    token = &tokens[i];
-                    if (token->start != 0xFFFF && token->end == 0xFFFF) {
+                    token = jsmn_token_at(parser, tokens, i);
+                    if (token->end == 0xFFFF) {
                         parser->toksuper = i;
                         break;
                     }
@@ -289,14 +538,16 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
                 parser->toksuper = parser->toknext - 1;
                 break;
             case ',':
-                if (tokens != NULL && parser->toksuper != 0xFFFF && tokens[parser->toksuper].type != JSMN_ARRAY &&
-                    tokens[parser->toksuper].type != JSMN_OBJECT) {
+                if (tokens != NULL && parser->toksuper != -1 &&
+                    JSMN_TOKEN_TYPE(jsmn_token_at(parser, tokens, parser->toksuper)) != JSMN_ARRAY &&
+                    JSMN_TOKEN_TYPE(jsmn_token_at(parser, tokens, parser->toksuper)) != JSMN_OBJECT) {
 #ifdef JSMN_PARENT_LINKS
-                    parser->toksuper = tokens[parser->toksuper].parent;
+                    parser->toksuper = jsmn_token_at(parser, tokens, parser->toksuper)->parent;
 #else
                     for (i = parser->toknext - 1; i >= 0; i--) {
-                        if (tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT) {
-                            if (tokens[i].start != 0xFFFF && tokens[i].end == 0xFFFF) {
+                        const jsmntok_t *t = jsmn_token_at(parser, tokens, i);
+                        if (JSMN_TOKEN_TYPE(t) == JSMN_ARRAY || JSMN_TOKEN_TYPE(t) == JSMN_OBJECT) {
+                            if (t->end == 0xFFFF) {
                                 parser->toksuper = i;
                                 break;
                             }
@@ -322,9 +573,9 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
             case 'f':
             case 'n':
                 /* And they must not be keys of the object */
-                if (tokens != NULL && parser->toksuper != 0xFFFF) {
-                    const jsmntok_t *t = &tokens[parser->toksuper];
-                    if (t->type == JSMN_OBJECT || (t->type == JSMN_STRING && (t->end - t->start) != 0)) {
+                if (tokens != NULL && parser->toksuper != -1) {
+                    const jsmntok_t *t = jsmn_token_at(parser, tokens, parser->toksuper);
+                    if (JSMN_TOKEN_TYPE(t) == JSMN_OBJECT || (JSMN_TOKEN_TYPE(t) == JSMN_STRING && JSMN_TOKEN_LEN(t) != 0)) {
                         return JSMN_ERROR_INVAL;
                     }
                 }
@@ -350,7 +601,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, j
     if (tokens != NULL) {
         for (i = parser->toknext - 1; i >= 0; i--) {
             /* Unmatched opened object or array */
-            if (tokens[i].start != 0xFFFF && tokens[i].end == 0xFFFF) {
+            if (jsmn_token_at(parser, tokens, i)->end == 0xFFFF) {
                 return JSMN_ERROR_PART;
             }
         }
@@ -367,6 +618,17 @@ JSMN_API void jsmn_init(jsmn_parser *parser) {
     parser->pos = 0;
     parser->toknext = 0;
     parser->toksuper = -1;
+    parser->streaming = 0;
+    parser->depth = 0;
+    parser->max_depth = 0;
+    parser->opaque = NULL;
+    parser->opaque_ctx = NULL;
+    parser->skip_depth = 0;
+    parser->skip_types = 0;
+    parser->skip_string = 0;
+    parser->spill = NULL;
+    parser->spill_len = 0;
+    parser->tokens_len = 0;
 }
 
 #ifdef __cplusplus
@@ -61,28 +61,61 @@ enum jsmnerr {
 };
 
 /**
- * JSON token description.
- * type		type (object, array, string etc.)
- * start	start position in JSON data string
- * end		end position in JSON data string
+ * JSON token description, packed in 4 bytes.
+ * start_type	start position in JSON data string (low 14 bits) and
+ *		type code (high 2 bits, the bit index of the jsmntype_t)
+ * end		end position in JSON data string, 0xFFFF while a container is open
+ *
+ * Use the JSMN_TOKEN_* accessors instead of the raw fields.
  */
 typedef struct jsmntok {
-    jsmntype_t type;
-    unsigned short start;
+    unsigned short start_type;
     unsigned short end;
 #ifdef JSMN_PARENT_LINKS
     int parent;
 #endif
 } jsmntok_t;
 
+/* Largest offset that fits in a token */
+#define JSMN_MAX_OFFSET 0x3FFF
+/* Longest accepted input. Tokens start before the end of the input and end is a full 16-bit field */
+#define JSMN_MAX_LENGTH (JSMN_MAX_OFFSET + 1)
+#define JSMN_TYPE_SHIFT 14
+
+#define JSMN_TOKEN_START(tok) ((unsigned short)((tok)->start_type & JSMN_MAX_OFFSET))
+#define JSMN_TOKEN_END(tok) ((tok)->end)
+#define JSMN_TOKEN_LEN(tok) ((unsigned short)(JSMN_TOKEN_END(tok) - JSMN_TOKEN_START(tok)))
+#define JSMN_TOKEN_TYPE(tok) ((jsmntype_t)(1u << ((tok)->start_type >> JSMN_TYPE_SHIFT)))
+
+/**
+ * Decides whether the value of a key is kept as a single opaque token.
+ * key/key_len point to the key in the JSON data, depth is the number of
+ * containers enclosing the key. Return non-zero to skip the value's contents.
+ */
+typedef int (*jsmn_opaque_cb)(void *ctx, const char *key, unsigned int key_len, unsigned int depth);
+
+/* Max nesting inside an opaque value, one bit of skip_types per level */
+#define JSMN_MAX_OPAQUE_DEPTH 32
+
 /**
  * JSON parser. Contains an array of token blocks available. Also stores
  * the string being parsed now and current position in that string.
  */
 typedef struct jsmn_parser {
-    unsigned int pos;     /* offset in the JSON string */
-    unsigned int toknext; /* next token to allocate */
-    int toksuper;         /* superior token node, e.g. parent object or array */
+    unsigned int pos;           /* offset in the JSON string */
+    unsigned int toknext;       /* next token to allocate */
+    int toksuper;               /* superior token node, e.g. parent object or array */
+    int streaming;              /* more input may follow, a primitive ending at len is incomplete */
+    unsigned int depth;         /* number of open containers */
+    unsigned int max_depth;     /* deepest nesting seen so far, opaque values excluded */
+    jsmn_opaque_cb opaque;      /* optional, see jsmn_opaque_cb */
+    void *opaque_ctx;           /* passed to opaque */
+    unsigned int skip_depth;    /* open containers in the opaque value being skipped, 0 if none */
+    unsigned int skip_types;    /* one bit per open container in the skip, set for arrays */
+    unsigned char skip_string;  /* 1 inside a string of the skipped value, 2 right after a backslash */
+    jsmntok_t *spill;           /* optional, tokens that do not fit in the array given to jsmn_parse */
+    unsigned int spill_len;     /* number of tokens in spill */
+    unsigned int tokens_len;    /* size of the array given to jsmn_parse, spill starts after it */
 } jsmn_parser;
 
 /**
@@ -96,6 +129,12 @@ JSMN_API void jsmn_init(jsmn_parser *parser);
  * a single JSON object.
  */
 JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, size_t len, jsmntok_t *tokens, unsigned int num_tokens);
+
+/**
+ * Fills token type and boundaries, for producers of JSON that record its
+ * tokens while writing it.
+ */
+JSMN_API void jsmn_fill_token(jsmntok_t *token, const jsmntype_t type, const int start, const int end);
 #ifdef __cplusplus
 }
 #endif
@@ -18,55 +18,177 @@
 #include "../common/parser_common.h"
 #include "jsmn/jsmn.h"
 
-parser_error_t array_get_element_count(const parsed_json_t *json, uint16_t array_token_index, uint16_t *number_elements) {
-    *number_elements = 0;
-    if (array_token_index > json->numberOfTokens) {
-        return parser_no_data;
+// A token belongs to the subtree of a container when it starts before the container ends.
+// Tokens are stored in document order, so children always come after their parent.
+#define TOKEN_IS_INSIDE(json, token_index, container_end) \
+    ((token_index) < (json)->numberOfTokens && JSMN_TOKEN_START(json_get_token(json, token_index)) < (container_end))
+
+// Tokens up to MAX_NUMBER_OF_TOKENS live in parsed_json_t, the rest in the spill tables
+const jsmntok_t *json_get_token(const parsed_json_t *json, uint16_t token_index) {
+    if (token_index < MAX_NUMBER_OF_TOKENS) {
+        return &json->tokens[token_index];
     }
+    return &json->spillTokens[token_index - MAX_NUMBER_OF_TOKENS];
+}
 
-    jsmntok_t array_token = json->tokens[array_token_index];
-    uint16_t token_index = array_token_index;
-    uint16_t prev_element_end = array_token.start;
-    while (true) {
-        token_index++;
-        if (token_index >= json->numberOfTokens) {
-            break;
-        }
-        jsmntok_t current_token = json->tokens[token_index];
-        if (current_token.start > array_token.end) {
-            break;
+static uint16_t json_get_next_sibling(const parsed_json_t *json, uint16_t token_index) {
+    if (token_index < MAX_NUMBER_OF_TOKENS) {
+        return json->nextSibling[token_index];
+    }
+    return json->spillNextSibling[token_index - MAX_NUMBER_OF_TOKENS];
+}
+
+static void json_set_next_sibling(parsed_json_t *json, uint16_t token_index, uint16_t next) {
+    if (token_index < MAX_NUMBER_OF_TOKENS) {
+        json->nextSibling[token_index] = next;
+        return;
+    }
+    json->spillNextSibling[token_index - MAX_NUMBER_OF_TOKENS] = next;
+}
+
+static uint8_t json_get_key_hash(const parsed_json_t *json, uint16_t token_index) {
+    if (token_index < MAX_NUMBER_OF_TOKENS) {
+        return json->keyHash[token_index];
+    }
+    return json->spillKeyHash[token_index - MAX_NUMBER_OF_TOKENS];
+}
+
+static void json_set_key_hash(parsed_json_t *json, uint16_t token_index, uint8_t hash) {
+    if (token_index < MAX_NUMBER_OF_TOKENS) {
+        json->keyHash[token_index] = hash;
+        return;
+    }
+    json->spillKeyHash[token_index - MAX_NUMBER_OF_TOKENS] = hash;
+}
+
+static void json_build_skip_index(parsed_json_t *json) {
+    // Walk backwards so the skip index of every child is already known when its parent is processed.
+    // Each parent only hops over its direct children, which keeps the whole pass linear.
+    for (int32_t i = (int32_t)json->numberOfTokens - 1; i >= 0; i--) {
+        const uint16_t end = JSMN_TOKEN_END(json_get_token(json, (uint16_t)i));
+        uint16_t next = (uint16_t)(i + 1);
+        while (TOKEN_IS_INSIDE(json, next, end)) {
+            next = json_get_next_sibling(json, next);
         }
-        if (current_token.start <= prev_element_end) {
+        json_set_next_sibling(json, (uint16_t)i, next);
+    }
+}
+
+// Only object keys are hashed, values are never read here. Runs after json_build_skip_index
+static void json_build_key_hashes(parsed_json_t *json) {
+    for (uint16_t i = 0; i < json->numberOfTokens; i++) {
+        json_set_key_hash(json, i, 0);
+    }
+
+    for (uint16_t i = 0; i < json->numberOfTokens; i++) {
+        if (JSMN_TOKEN_TYPE(json_get_token(json, i)) != JSMN_OBJECT) {
             continue;
         }
-        prev_element_end = current_token.end;
-        (*number_elements)++;
+
+        json_iter_t iter;
+        uint16_t key_index = 0;
+        uint16_t value_index = 0;
+        json_object_iter_begin(json, i, &iter);
+        while (json_object_iter_next(json, &iter, &key_index, &value_index) == parser_ok) {
+            const jsmntok_t *key = json_get_token(json, key_index);
+            json_set_key_hash(json, key_index, json_key_hash(json->buffer + JSMN_TOKEN_START(key), JSMN_TOKEN_LEN(key)));
+        }
+    }
+}
+
+// Splits the spill buffer into the token, skip index and key hash tables of the second tier
+static void json_set_spill(parsed_json_t *parsed_json, uint8_t *spill, uint16_t spillLen) {
+    parsed_json->spillTokens = NULL;
+    parsed_json->spillNextSibling = NULL;
+    parsed_json->spillKeyHash = NULL;
+    parsed_json->spillCapacity = 0;
+
+    // Tokens and skip index entries are 16-bit fields
+    const uint16_t padding = (uint16_t)((uintptr_t)spill % sizeof(uint16_t));
+    if (spill == NULL || spillLen <= padding) {
+        return;
+    }
+
+    uint16_t capacity = (uint16_t)((spillLen - padding) / JSON_SPILL_BYTES_PER_TOKEN);
+    if (capacity > JSMN_MAX_OFFSET) {
+        capacity = JSMN_MAX_OFFSET;
+    }
+    if (capacity == 0) {
+        return;
+    }
+
+    parsed_json->spillTokens = (jsmntok_t *)(spill + padding);
+    parsed_json->spillNextSibling = (uint16_t *)(parsed_json->spillTokens + capacity);
+    parsed_json->spillKeyHash = (uint8_t *)(parsed_json->spillNextSibling + capacity);
+    parsed_json->spillCapacity = capacity;
+    parsed_json->tokenizer.spill = parsed_json->spillTokens;
+    parsed_json->tokenizer.spill_len = capacity;
+}
+
+parser_error_t json_array_iter_begin(const parsed_json_t *json, uint16_t array_token_index, json_iter_t *iter) {
+    if (array_token_index >= json->numberOfTokens) {
+        return parser_no_data;
     }
 
+    iter->token_index = array_token_index + 1;
+    iter->container_end = JSMN_TOKEN_END(json_get_token(json, array_token_index));
+
     return parser_ok;
 }
 
-parser_error_t array_get_nth_element(const parsed_json_t *json, uint16_t array_token_index, uint16_t element_index,
-                                     uint16_t *token_index) {
-    if (array_token_index > json->numberOfTokens) {
+parser_error_t json_array_iter_next(const parsed_json_t *json, json_iter_t *iter, uint16_t *element_token_index) {
+    if (!TOKEN_IS_INSIDE(json, iter->token_index, iter->container_end)) {
         return parser_no_data;
     }
 
-    jsmntok_t array_token = json->tokens[array_token_index];
-    *token_index = array_token_index;
+    *element_token_index = iter->token_index;
+    iter->token_index = json_get_next_sibling(json, iter->token_index);
+
+    return parser_ok;
+}
+
+parser_error_t json_object_iter_begin(const parsed_json_t *json, uint16_t object_token_index, json_iter_t *iter) {
+    return json_array_iter_begin(json, object_token_index, iter);
+}
+
+parser_error_t json_object_iter_next(const parsed_json_t *json, json_iter_t *iter, uint16_t *key_token_index,
+                                     uint16_t *value_token_index) {
+    if (!TOKEN_IS_INSIDE(json, iter->token_index, iter->container_end)) {
+        return parser_no_data;
+    }
 
+    const uint16_t value_index = json_get_next_sibling(json, iter->token_index);
+    if (!TOKEN_IS_INSIDE(json, value_index, iter->container_end)) {
+        return parser_no_data;
+    }
+
+    *key_token_index = iter->token_index;
+    *value_token_index = value_index;
+    iter->token_index = json_get_next_sibling(json, value_index);
+
+    return parser_ok;
+}
+
+parser_error_t array_get_element_count(const parsed_json_t *json, uint16_t array_token_index, uint16_t *number_elements) {
+    json_iter_t iter;
+    uint16_t element_index = 0;
+
+    *number_elements = 0;
+    CHECK_ERROR(json_array_iter_begin(json, array_token_index, &iter))
+    while (json_array_iter_next(json, &iter, &element_index) == parser_ok) {
+        (*number_elements)++;
+    }
+
+    return parser_ok;
+}
+
+parser_error_t array_get_nth_element(const parsed_json_t *json, uint16_t array_token_index, uint16_t element_index,
+                                     uint16_t *token_index) {
+    json_iter_t iter;
     uint16_t element_count = 0;
-    uint16_t prev_element_end = array_token.start;
-    while (*token_index < json->numberOfTokens) {
-        (*token_index)++;
-        jsmntok_t current_token = json->tokens[*token_index];
-        if (current_token.start > array_token.end) {
-            break;
-        }
-        if (current_token.start <= prev_element_end) {
-            continue;
-        }
-        prev_element_end = current_token.end;
+
+    CHECK_ERROR(json_array_iter_begin(json, array_token_index, &iter))
+    while (json_array_iter_next(json, &iter, token_index) == parser_ok) {
         if (element_count == element_index) {
             return parser_ok;
         }
@@ -77,28 +199,13 @@ parser_error_t array_get_nth_element(const parsed_json_t *json, uint16_t array_t
 }
 
 parser_error_t object_get_element_count(const parsed_json_t *json, uint16_t object_token_index, uint16_t *element_count) {
-    *element_count = 0;
-    if (object_token_index > json->numberOfTokens) {
-        return parser_no_data;
-    }
+    json_iter_t iter;
+    uint16_t key_index = 0;
+    uint16_t value_index = 0;
 
-    jsmntok_t object_token = json->tokens[object_token_index];
-    uint16_t token_index = object_token_index;
-    uint16_t prev_element_end = object_token.start;
-    token_index++;
-    while (true) {
-        if (token_index >= json->numberOfTokens) {
-            break;
-        }
-        jsmntok_t key_token = json->tokens[token_index++];
-        jsmntok_t value_token = json->tokens[token_index];
-        if (key_token.start > object_token.end) {
-            break;
-        }
-        if (key_token.start <= prev_element_end) {
-            continue;
-        }
-        prev_element_end = value_token.end;
+    *element_count = 0;
+    CHECK_ERROR(json_object_iter_begin(json, object_token_index, &iter))
+    while (json_object_iter_next(json, &iter, &key_index, &value_index) == parser_ok) {
         (*element_count)++;
     }
 
@@ -107,30 +214,14 @@ parser_error_t object_get_element_count(const parsed_json_t *json, uint16_t obje
 
 parser_error_t object_get_nth_key(const parsed_json_t *json, uint16_t object_token_index, uint16_t object_element_index,
                                   uint16_t *token_index) {
-    *token_index = object_token_index;
-    if (object_token_index > json->numberOfTokens) {
-        return parser_no_data;
-    }
-
-    jsmntok_t object_token = json->tokens[object_token_index];
+    json_iter_t iter;
     uint16_t element_count = 0;
-    uint16_t prev_element_end = object_token.start;
-    (*token_index)++;
-    while (true) {
-        if (*token_index >= json->numberOfTokens) {
-            break;
-        }
-        jsmntok_t key_token = json->tokens[(*token_index)++];
-        jsmntok_t value_token = json->tokens[*token_index];
-        if (key_token.start > object_token.end) {
-            break;
-        }
-        if (key_token.start <= prev_element_end) {
-            continue;
-        }
-        prev_element_end = value_token.end;
+    uint16_t value_index = 0;
+
+    *token_index = object_token_index;
+    CHECK_ERROR(json_object_iter_begin(json, object_token_index, &iter))
+    while (json_object_iter_next(json, &iter, token_index, &value_index) == parser_ok) {
         if (element_count == object_element_index) {
-            (*token_index)--;
             return parser_ok;
         }
         element_count++;
@@ -141,82 +232,244 @@ parser_error_t object_get_nth_key(const parsed_json_t *json, uint16_t object_tok
 
 parser_error_t object_get_nth_value(const parsed_json_t *json, uint16_t object_token_index, uint16_t object_element_index,
                                     uint16_t *key_index) {
-    if (object_token_index > json->numberOfTokens) {
+    if (object_token_index >= json->numberOfTokens) {
         return parser_no_data;
     }
 
     CHECK_ERROR(object_get_nth_key(json, object_token_index, object_element_index, key_index))
-    (*key_index)++;
+    *key_index = json_get_next_sibling(json, *key_index);
 
     return parser_ok;
 }
 
+uint8_t json_key_hash(const char *data, uint16_t len) {
+    uint8_t hash = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        hash = (uint8_t)((hash ^ (uint8_t)data[i]) * 167u);
+    }
+    return hash;
+}
+
+bool json_token_equals_key(const parsed_json_t *json, uint16_t token_index, const json_key_t *key) {
+    if (token_index >= json->numberOfTokens) {
+        return false;
+    }
+
+    const jsmntok_t *token = json_get_token(json, token_index);
+    return json_key_matches(key, json->buffer + JSMN_TOKEN_START(token), JSMN_TOKEN_LEN(token),
+                            json_get_key_hash(json, token_index));
+}
+
+bool json_key_matches(const json_key_t *key, const char *data, uint16_t len, uint8_t hash) {
+    if (len != key->len || hash != key->hash) {
+        return false;
+    }
+
+    return MEMCMP(data, (const char *)PIC(key->str), key->len) == 0;
+}
+
+parser_error_t object_get_value_by_key(const parsed_json_t *json, uint16_t object_token_index, const json_key_t *key,
+                                       uint16_t *token_index) {
+    json_iter_t iter;
+    uint16_t key_index = 0;
+
+    CHECK_ERROR(json_object_iter_begin(json, object_token_index, &iter))
+    while (json_object_iter_next(json, &iter, &key_index, token_index) == parser_ok) {
+        if (json_token_equals_key(json, key_index, key)) {
+            return parser_ok;
+        }
+    }
+
+    return parser_no_data;
+}
+
 parser_error_t object_get_value(const parsed_json_t *json, uint16_t object_token_index, const char *key_name,
                                 uint16_t *token_index) {
-    if (object_token_index > json->numberOfTokens) {
+    const size_t key_len = strlen(key_name);
+    if (key_len > UINT8_MAX) {
         return parser_no_data;
     }
 
-    const jsmntok_t object_token = json->tokens[object_token_index];
+    const json_key_t key = {(uint8_t)key_len, json_key_hash(key_name, (uint16_t)key_len), key_name};
+    return object_get_value_by_key(json, object_token_index, &key, token_index);
+}
 
-    *token_index = object_token_index;
-    int prev_element_end = object_token.start;
-    (*token_index)++;
+static parser_error_t json_convert_jsmn_error(int error) {
+    switch (error) {
+        case JSMN_ERROR_NOMEM:
+            return parser_json_too_many_tokens;
+        case JSMN_ERROR_INVAL:
+            return parser_unexpected_characters;
+        case JSMN_ERROR_PART:
+            return parser_json_incomplete_json;
+        default:
+            return parser_json_unexpected_error;
+    }
+}
 
-    while (*token_index < json->numberOfTokens) {
-        const jsmntok_t key_token = json->tokens[*token_index];
-        (*token_index)++;
-        const jsmntok_t value_token = json->tokens[*token_index];
+// jsmn_opaque_cb for a json_opaque_keys_t: only keys of the top-level object are considered
+static int json_is_opaque_key(void *ctx, const char *key, unsigned int key_len, unsigned int depth) {
+    const json_opaque_keys_t *opaque = (const json_opaque_keys_t *)ctx;
+    if (depth != 1 || key_len > UINT8_MAX) {
+        return 0;
+    }
 
-        if (key_token.start > object_token.end) {
-            break;
+    const uint8_t hash = json_key_hash(key, (uint16_t)key_len);
+    const json_key_t *const *keys = (const json_key_t *const *)PIC(opaque->keys);
+    for (uint8_t i = 0; i < opaque->count; i++) {
+        if (json_key_matches((const json_key_t *)PIC(keys[i]), key, (uint16_t)key_len, hash)) {
+            return 1;
         }
-        if (key_token.start <= prev_element_end) {
-            continue;
+    }
+    return 0;
+}
+
+// Returns the position of the bracket closing the container opened at pos, or bufferLen
+static uint16_t json_skip_container(const char *buffer, uint16_t bufferLen, uint16_t pos) {
+    uint16_t depth = 0;
+    for (; pos < bufferLen && buffer[pos] != '\0'; pos++) {
+        switch (buffer[pos]) {
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                if (depth == 0) {
+                    return pos;
+                }
+                break;
+            case '\"':
+                for (pos++; pos < bufferLen && buffer[pos] != '\"'; pos++) {
+                    if (buffer[pos] == '\\') {
+                        pos++;
+                    }
+                }
+                break;
+            default:
+                break;
         }
-        prev_element_end = value_token.end;
+    }
+    return bufferLen;
+}
 
-        if (((uint16_t)strlen(key_name)) == (key_token.end - key_token.start)) {
-            uint16_t i = 0;
-            for (; i < (uint16_t)strlen(key_name); i++) {
-                if (json->buffer[key_token.start + i] != key_name[i]) {
+// Counts the tokens jsmn would produce for the input without storing them, and checks the nesting depth.
+// Malformed input is not reported here, the tokenizer does it; this pass only bounds the work of the full one.
+static parser_error_t json_count_tokens(const char *buffer, uint16_t bufferLen, const json_opaque_keys_t *opaque,
+                                        uint32_t max_tokens, uint16_t *count) {
+    uint32_t tokens = 0;
+    uint16_t depth = 0;
+    // Last string seen, it is a key when followed by ':'
+    uint16_t key_start = 0;
+    uint16_t key_len = 0;
+    bool has_string = false;
+    bool is_value = false;
+
+    *count = 0;
+    for (uint16_t pos = 0; pos < bufferLen && buffer[pos] != '\0'; pos++) {
+        switch (buffer[pos]) {
+            case '{':
+            case '[':
+                tokens++;
+                if (is_value && opaque != NULL &&
+                    json_is_opaque_key((void *)opaque, buffer + key_start, key_len, depth)) {
+                    pos = json_skip_container(buffer, bufferLen, pos);
+                    has_string = is_value = false;
                     break;
                 }
-            }
-            if (i == strlen(key_name)) {
-                return parser_ok;
-            }
+                depth++;
+                if (depth > MAX_JSON_DEPTH) {
+                    return parser_value_out_of_range;
+                }
+                has_string = is_value = false;
+                break;
+            case '}':
+            case ']':
+                if (depth > 0) {
+                    depth--;
+                }
+                has_string = is_value = false;
+                break;
+            case '\"':
+                tokens++;
+                key_start = pos + 1;
+                // Jump to the closing quote, skipping escaped characters
+                for (pos++; pos < bufferLen && buffer[pos] != '\"'; pos++) {
+                    if (buffer[pos] == '\\') {
+                        pos++;
+                    }
+                }
+                key_len = pos - key_start;
+                has_string = true;
+                is_value = false;
+                break;
+            case ':':
+                is_value = has_string;
+                has_string = false;
+                break;
+            case '\t':
+            case '\r':
+            case '\n':
+            case ' ':
+                break;
+            case ',':
+                has_string = is_value = false;
+                break;
+            default:
+                // Primitive: same delimiters as jsmn_parse_primitive in non-strict mode
+                tokens++;
+                while (pos + 1 < bufferLen && strchr(":\t\r\n ,]}", buffer[pos + 1]) == NULL) {
+                    pos++;
+                }
+                has_string = is_value = false;
+                break;
+        }
+
+        if (tokens > max_tokens) {
+            return parser_json_too_many_tokens;
         }
     }
 
-    return parser_no_data;
+    *count = (uint16_t)tokens;
+    return parser_ok;
 }
 
-parser_error_t json_parse(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen) {
-    jsmn_parser parser;
-
-    jsmn_init(&parser);
-
-    MEMZERO(parsed_json, sizeof(parsed_json_t));
+// Clears everything but the token tables, which are overwritten up to numberOfTokens by the tokenizer
+static void json_reset(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                       const json_opaque_keys_t *opaque) {
+    json_set_spill(parsed_json, NULL, 0);
+    parsed_json->isValid = false;
+    parsed_json->isStreaming = false;
+    parsed_json->numberOfTokens = 0;
     parsed_json->buffer = buffer;
     parsed_json->bufferLen = bufferLen;
+    jsmn_init(&parsed_json->tokenizer);
+    if (opaque != NULL) {
+        parsed_json->tokenizer.opaque = json_is_opaque_key;
+        parsed_json->tokenizer.opaque_ctx = (void *)opaque;
+    }
+}
+
+// Runs (or resumes) the tokenizer up to bufferLen and builds the lookup tables
+static parser_error_t json_parse_tokens(parsed_json_t *parsed_json) {
+    // Offsets must fit in the packed tokens
+    if (parsed_json->bufferLen > JSMN_MAX_LENGTH) {
+        return parser_value_out_of_range;
+    }
 
-    int16_t num_tokens =
-        jsmn_parse(&parser, parsed_json->buffer, parsed_json->bufferLen, parsed_json->tokens, MAX_NUMBER_OF_TOKENS);
+    int16_t num_tokens = jsmn_parse(&parsed_json->tokenizer, parsed_json->buffer, parsed_json->bufferLen,
+                                    parsed_json->tokens, MAX_NUMBER_OF_TOKENS);
 
     ZEMU_LOGF(35, "num_tokens: %d\n", num_tokens);
 
     if (num_tokens < 0) {
-        switch (num_tokens) {
-            case JSMN_ERROR_NOMEM:
-                return parser_json_too_many_tokens;
-            case JSMN_ERROR_INVAL:
-                return parser_unexpected_characters;
-            case JSMN_ERROR_PART:
-                return parser_json_incomplete_json;
-            default:
-                return parser_json_unexpected_error;
-        }
+        return json_convert_jsmn_error(num_tokens);
+    }
+
+    // Streamed inputs skip the counting pass, so the nesting depth is checked here as well
+    if (parsed_json->tokenizer.max_depth > MAX_JSON_DEPTH) {
+        return parser_value_out_of_range;
     }
 
     parsed_json->numberOfTokens = 0;
@@ -228,12 +481,118 @@ parser_error_t json_parse(parsed_json_t *parsed_json, const char *buffer, uint16
     }
 
     // We cannot support if number of tokens exceeds the limit
-    if (num_tokens > MAX_NUMBER_OF_TOKENS) {
+    if (num_tokens > MAX_NUMBER_OF_TOKENS + parsed_json->spillCapacity) {
         return parser_json_too_many_tokens;
     }
 
     parsed_json->numberOfTokens = num_tokens;
+    json_build_skip_index(parsed_json);
+    json_build_key_hashes(parsed_json);
+    parsed_json->isValid = true;
+
+    return parser_ok;
+}
+
+void json_parse_stream_init(parsed_json_t *parsed_json, const json_opaque_keys_t *opaque) {
+    json_reset(parsed_json, NULL, 0, opaque);
+    parsed_json->tokenizer.streaming = 1;
+    parsed_json->isStreaming = true;
+}
+
+parser_error_t json_parse_stream_append(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen) {
+    if (!parsed_json->isStreaming) {
+        return parser_unexpected_error;
+    }
+
+    // The data may have been moved to a different buffer, offsets are still valid
+    parsed_json->buffer = buffer;
+    parsed_json->bufferLen = bufferLen;
+
+    if (bufferLen > JSMN_MAX_LENGTH) {
+        parsed_json->isStreaming = false;
+        return parser_value_out_of_range;
+    }
+
+    const int r = jsmn_parse(&parsed_json->tokenizer, buffer, bufferLen, parsed_json->tokens, MAX_NUMBER_OF_TOKENS);
+    if (r < 0 && r != JSMN_ERROR_PART) {
+        // Leave the error to the final full parse
+        parsed_json->isStreaming = false;
+        return json_convert_jsmn_error(r);
+    }
+
+    // Stop tokenizing too deeply nested inputs, the final full parse reports them
+    if (parsed_json->tokenizer.max_depth > MAX_JSON_DEPTH) {
+        parsed_json->isStreaming = false;
+        return parser_value_out_of_range;
+    }
+
+    return parser_ok;
+}
+
+parser_error_t json_parse_stream_finish(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                                        const json_parse_config_t *config) {
+    const json_opaque_keys_t *opaque = config != NULL ? config->opaque : NULL;
+    if (!parsed_json->isStreaming || bufferLen < parsed_json->tokenizer.pos ||
+        parsed_json->tokenizer.opaque_ctx != (const void *)opaque) {
+        return json_parse_with_config(parsed_json, buffer, bufferLen, config);
+    }
+
+    parsed_json->isStreaming = false;
+    parsed_json->buffer = buffer;
+    parsed_json->bufferLen = bufferLen;
+    parsed_json->tokenizer.streaming = 0;
+    // The upload is complete, so the spill buffer is no longer in use by the transport
+    if (config != NULL) {
+        json_set_spill(parsed_json, config->spill, config->spillLen);
+    }
+
+    return json_parse_tokens(parsed_json);
+}
+
+parser_error_t json_parse_generated(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                                    uint16_t numberOfTokens) {
+    json_reset(parsed_json, buffer, bufferLen, NULL);
+    if (bufferLen > JSMN_MAX_LENGTH) {
+        return parser_value_out_of_range;
+    }
+    if (numberOfTokens == 0) {
+        return parser_json_zero_tokens;
+    }
+    if (numberOfTokens > MAX_NUMBER_OF_TOKENS) {
+        return parser_json_too_many_tokens;
+    }
+
+    parsed_json->numberOfTokens = numberOfTokens;
+    json_build_skip_index(parsed_json);
+    json_build_key_hashes(parsed_json);
     parsed_json->isValid = true;
 
     return parser_ok;
-}
\ No newline at end of file
+}
+
+parser_error_t json_parse(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen) {
+    return json_parse_with_config(parsed_json, buffer, bufferLen, NULL);
+}
+
+parser_error_t json_parse_with_config(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                                      const json_parse_config_t *config) {
+    const json_opaque_keys_t *opaque = config != NULL ? config->opaque : NULL;
+    uint16_t num_tokens = 0;
+
+    json_reset(parsed_json, buffer, bufferLen, opaque);
+    if (config != NULL) {
+        json_set_spill(parsed_json, config->spill, config->spillLen);
+    }
+    if (bufferLen > JSMN_MAX_LENGTH) {
+        return parser_value_out_of_range;
+    }
+
+    // Reject oversized or too deeply nested inputs before touching the token table
+    CHECK_ERROR(json_count_tokens(buffer, bufferLen, opaque, MAX_NUMBER_OF_TOKENS + parsed_json->spillCapacity,
+                                  &num_tokens))
+    if (num_tokens == 0) {
+        return parser_json_zero_tokens;
+    }
+
+    return json_parse_tokens(parsed_json);
+}
@@ -27,22 +27,81 @@
 #define MAX_NUMBER_OF_TOKENS 768
 
 // Limit depending on target
-#if defined(TARGET_NANOS) || defined(TARGET_NANOX)
+// Each token takes 7 bytes here (packed token, skip index and key hash).
+// The budget includes the RAM freed by the 4-byte item_t (12 bytes less per item than before)
+#if defined(TARGET_NANOS)
 #undef MAX_NUMBER_OF_TOKENS
-#define MAX_NUMBER_OF_TOKENS 110
+#define MAX_NUMBER_OF_TOKENS 240
+#elif defined(TARGET_NANOX)
+#undef MAX_NUMBER_OF_TOKENS
+#define MAX_NUMBER_OF_TOKENS 320
 #endif
 
+/// Max nesting depth of objects and arrays in the JSON input
+#define MAX_JSON_DEPTH 32
+
+/// Bytes of spill buffer taken by each token past MAX_NUMBER_OF_TOKENS
+#define JSON_SPILL_BYTES_PER_TOKEN (sizeof(jsmntok_t) + sizeof(uint16_t) + sizeof(uint8_t))
+
 // Context that keeps all the parsed data together. That includes:
 //  - parsed json tokens
+//  - skip index: for each token, the index of the first token that is not part of its subtree
+//    (i.e. its next sibling, or the next token after its parent when it is the last child)
+//  - key hash: json_key_hash of every object key (0 for other tokens), so keys can be rejected without touching the buffer
+//  - spill tables: same three tables for the tokens past MAX_NUMBER_OF_TOKENS, in memory lent by the caller.
+//    Use json_get_token so both tiers look like a single table
+//  - tokenizer state, so the input can be tokenized while it is still being received
 //  - re-created SendMsg struct with indices pointing to tokens in parsed json
 typedef struct {
     uint8_t isValid;
+    uint8_t isStreaming;
     uint32_t numberOfTokens;
     jsmntok_t tokens[MAX_NUMBER_OF_TOKENS];
+    uint16_t nextSibling[MAX_NUMBER_OF_TOKENS];
+    uint8_t keyHash[MAX_NUMBER_OF_TOKENS];
+    jsmntok_t *spillTokens;
+    uint16_t *spillNextSibling;
+    uint8_t *spillKeyHash;
+    uint16_t spillCapacity;
     const char *buffer;
     uint16_t bufferLen;
+    jsmn_parser tokenizer;
 } parsed_json_t;
 
+// Descriptor of a key that is known at compile time.
+// The hash must be json_key_hash(str, len); use JSON_KEY to declare one.
+typedef struct {
+    uint8_t len;
+    uint8_t hash;
+    const char *str;
+} json_key_t;
+
+#define JSON_KEY(__str, __hash) \
+    { sizeof(__str) - 1, __hash, __str }
+
+// Keys of the top-level object whose object or array values are kept as a single opaque token.
+// Their contents are only checked for matching brackets and closed strings, and get no tokens of their own.
+typedef struct {
+    const json_key_t *const *keys;
+    uint8_t count;
+} json_opaque_keys_t;
+
+// Optional parsing settings
+typedef struct {
+    // Keys whose values get a single token, may be NULL
+    const json_opaque_keys_t *opaque;
+    // Memory for the tokens past MAX_NUMBER_OF_TOKENS, may be NULL. It must outlive the parsed data
+    uint8_t *spill;
+    uint16_t spillLen;
+} json_parse_config_t;
+
+// Forward cursor over the direct children of an array or object.
+// Each step jumps over the whole subtree of the current child using the skip index.
+typedef struct {
+    uint16_t token_index;
+    uint16_t container_end;
+} json_iter_t;
+
 /// Parse json to create a token representation
 /// \param parsed_json
 /// \param transaction
@@ -50,6 +109,53 @@ typedef struct {
 /// \return Error message
 parser_error_t json_parse(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen);
 
+/// Parse json to create a token representation with the given settings
+/// \param parsed_json
+/// \param buffer
+/// \param bufferLen
+/// \param config: opaque keys and spill buffer, may be NULL
+/// \return Error message
+parser_error_t json_parse_with_config(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                                      const json_parse_config_t *config);
+
+/// Start tokenizing an input that will be received in chunks
+/// \param parsed_json
+/// \param opaque: keys whose values get a single token, may be NULL
+void json_parse_stream_init(parsed_json_t *parsed_json, const json_opaque_keys_t *opaque);
+
+/// Tokenize the data received so far. A value cut at the end of the data is resumed on the next call
+/// \param parsed_json
+/// \param buffer: all the data received so far, it may have moved since the previous call
+/// \param bufferLen
+/// \return Error message. On error the stream is dropped and json_parse_stream_finish parses the whole input again
+parser_error_t json_parse_stream_append(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen);
+
+/// Tokenize the remaining data and build the lookup tables. The spill buffer is only used from here on
+/// Falls back to json_parse_with_config when there is no matching stream in progress
+/// \param parsed_json
+/// \param buffer: the complete input
+/// \param bufferLen
+/// \param config: opaque keys and spill buffer, may be NULL
+/// \return Error message
+parser_error_t json_parse_stream_finish(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                                        const json_parse_config_t *config);
+
+/// Use the tokens that the producer of the input stored in parsed_json->tokens while writing it.
+/// They must be the tokens json_parse_with_config would produce. Only the lookup tables are built
+/// \param parsed_json
+/// \param buffer: the complete input
+/// \param bufferLen
+/// \param numberOfTokens: number of stored tokens, at most MAX_NUMBER_OF_TOKENS
+/// \return Error message
+parser_error_t json_parse_generated(parsed_json_t *parsed_json, const char *buffer, uint16_t bufferLen,
+                                    uint16_t numberOfTokens);
+
+/// Get a token, wherever it is stored
+/// \param json
+/// \param token_index: must be lower than numberOfTokens
+/// \return token
+const jsmntok_t *json_get_token(const parsed_json_t *json, uint16_t token_index);
+
 /// Get the number of elements in the array
 /// \param json
 /// \param array_token_index
@@ -97,4 +203,64 @@ parser_error_t object_get_nth_value(const parsed_json_t *json, uint16_t object_t
 /// \param key_name: key name of the wanted value
 /// \return Error message
 parser_error_t object_get_value(const parsed_json_t *json, uint16_t object_token_index, const char *key_name,
-                                uint16_t *token_index);
\ No newline at end of file
+                                uint16_t *token_index);
+
+/// Get the token index of the value that matches the given key descriptor
+/// \param json
+/// \param object_token_index: token index of the parent object
+/// \param key: descriptor of the wanted key
+/// \param token_index (out)
+/// \return Error message
+parser_error_t object_get_value_by_key(const parsed_json_t *json, uint16_t object_token_index, const json_key_t *key,
+                                       uint16_t *token_index);
+
+/// Check whether a token holds exactly the given key
+/// \param json
+/// \param token_index: an object key, other tokens have no hash and never match
+/// \param key
+/// \return true when the token matches
+bool json_token_equals_key(const parsed_json_t *json, uint16_t token_index, const json_key_t *key);
+
+/// Check whether a string holds exactly the given key
+/// \param key
+/// \param data
+/// \param len
+/// \param hash: json_key_hash of data
+/// \return true when the string matches
+bool json_key_matches(const json_key_t *key, const char *data, uint16_t len, uint8_t hash);
+
+/// Hash used to pre-filter key comparisons
+/// \param data
+/// \param len
+/// \return 8-bit hash
+uint8_t json_key_hash(const char *data, uint16_t len);
+
+/// Start iterating the elements of an array
+/// \param json
+/// \param array_token_index
+/// \param iter (out)
+/// \return Error message
+parser_error_t json_array_iter_begin(const parsed_json_t *json, uint16_t array_token_index, json_iter_t *iter);
+
+/// Move to the next array element
+/// \param json
+/// \param iter
+/// \param element_token_index (out)
+/// \return parser_ok, or parser_no_data once all the elements have been visited
+parser_error_t json_array_iter_next(const parsed_json_t *json, json_iter_t *iter, uint16_t *element_token_index);
+
+/// Start iterating the key/value pairs of an object
+/// \param json
+/// \param object_token_index
+/// \param iter (out)
+/// \return Error message
+parser_error_t json_object_iter_begin(const parsed_json_t *json, uint16_t object_token_index, json_iter_t *iter);
+
+/// Move to the next key/value pair
+/// \param json
+/// \param iter
+/// \param key_token_index (out)
+/// \param value_token_index (out)
+/// \return parser_ok, or parser_no_data once all the pairs have been visited
+parser_error_t json_object_iter_next(const parsed_json_t *json, json_iter_t *iter, uint16_t *key_token_index,
+                                     uint16_t *value_token_index);
@@ -26,15 +26,75 @@
 #include "crypto.h"
 #include "crypto_helper.h"
 #include "items.h"
+#include "items_format.h"
 #include "parser_impl.h"
 #include "tx.h"
 
 static parser_error_t parser_getItemKey(uint8_t displayIdx, char *outKey, uint16_t outKeyLen);
 
-#define MAX_ITEM_LENGTH_IN_PAGE 40
+// Bytes kept for rendered item values
+#if defined(TARGET_NANOS) || defined(TARGET_NANOX)
+#define RENDER_CACHE_SIZE 256
+#else
+#define RENDER_CACHE_SIZE 2048
+#endif
+
+// Start of an item that was not rendered yet, or that is too long for the cache
+#define RENDER_CACHE_UNSET 0xFFFF
+#define RENDER_CACHE_SKIPPED 0xFFFE
+
+// Rendered values of review items, so that page turns only copy a slice of them.
+// Items are added in the order they are shown, each one that fits in the free tail of data is kept.
+typedef struct {
+    uint16_t start[MAX_NUMBER_OF_ITEMS];
+    uint16_t end[MAX_NUMBER_OF_ITEMS];
+    uint16_t used;
+    char data[RENDER_CACHE_SIZE];
+} render_cache_t;
 
 tx_json_t tx_obj_json;
 tx_hash_t tx_obj_hash;
+static render_cache_t render_cache;
+
+static void parser_renderCacheReset() {
+    for (uint8_t i = 0; i < MAX_NUMBER_OF_ITEMS; i++) {
+        render_cache.start[i] = RENDER_CACHE_UNSET;
+    }
+    render_cache.used = 0;
+}
+
+static bool parser_renderCacheHas(uint8_t displayIdx) {
+    return displayIdx < MAX_NUMBER_OF_ITEMS && render_cache.start[displayIdx] < RENDER_CACHE_SKIPPED;
+}
+
+// Render the item straight into the free tail of the cache, it is only kept when the whole value fits
+static void parser_renderCacheAdd(uint8_t displayIdx, item_t item) {
+    if (displayIdx >= MAX_NUMBER_OF_ITEMS || render_cache.start[displayIdx] != RENDER_CACHE_UNSET) {
+        return;
+    }
+
+    const item_formatter_t formatter = items_getFormatter(item.key);
+    if (formatter == NULL) {
+        return;
+    }
+
+    const uint16_t start = render_cache.used;
+    item_writer_t writer;
+    items_writerInit(&writer, render_cache.data + start, RENDER_CACHE_SIZE - start, 0);
+    if (formatter(item, &writer) != items_ok) {
+        return;
+    }
+
+    // Not tried again, smaller items shown later can still use the free tail
+    if (writer.valueLen > (uint32_t)(RENDER_CACHE_SIZE - start)) {
+        render_cache.start[displayIdx] = RENDER_CACHE_SKIPPED;
+        return;
+    }
+
+    render_cache.start[displayIdx] = start;
+    render_cache.end[displayIdx] = start + (uint16_t)writer.valueLen;
+    render_cache.used = render_cache.end[displayIdx];
+}
 
 parser_error_t parser_init_context(parser_context_t *ctx, const uint8_t *buffer, uint16_t bufferSize) {
     ctx->offset = 0;
@@ -51,12 +111,26 @@ parser_error_t parser_init_context(parser_context_t *ctx, const uint8_t *buffer,
     return parser_ok;
 }
 
+void parser_streamInit() { json_parse_stream_init(&tx_obj_json.json, &cmd_opaque_keys); }
+
+void parser_streamReset() { tx_obj_json.json.isStreaming = false; }
+
+parser_error_t parser_streamAppend(const uint8_t *data, size_t dataLen) {
+    if (data == NULL || dataLen > UINT16_MAX) {
+        parser_streamReset();
+        return parser_unexpected_buffer_end;
+    }
+
+    return json_parse_stream_append(&tx_obj_json.json, (const char *)data, (uint16_t)dataLen);
+}
+
 parser_error_t parser_parse(parser_context_t *ctx, const uint8_t *data, size_t dataLen, tx_type_t tx_type) {
     if (tx_type == tx_type_hash && !app_mode_blindsign()) {
         return parser_blindsign_mode_required;
     }
 
     CHECK_ERROR(parser_init_context(ctx, data, dataLen))
+    parser_renderCacheReset();
     switch (tx_type) {
         case tx_type_json:
             ctx->json = &tx_obj_json;
@@ -67,11 +141,8 @@ parser_error_t parser_parse(parser_context_t *ctx, const uint8_t *data, size_t d
             CHECK_ERROR(_read_hash_tx(ctx));
             break;
         case tx_type_transfer:
-            CHECK_ERROR(parser_createJsonTemplate(ctx));
             ctx->json = &tx_obj_json;
-            ctx->buffer = tx_json_get_buffer();
-            ctx->bufferLen = (uint16_t)tx_json_get_buffer_length();
-            CHECK_ERROR(_read_json_tx(ctx));
+            CHECK_ERROR(_read_json_template_tx(ctx));
             break;
         default:
             return parser_unexpected_type;
@@ -83,16 +154,24 @@ parser_error_t parser_parse(parser_context_t *ctx, const uint8_t *data, size_t d
 }
 
 parser_error_t parser_validate(parser_context_t *ctx) {
-    // Iterate through all items to check that all can be shown and are valid
+    // Iterate through all items to check that all can be shown and are valid.
+    // Items are only measured here, they are formatted once they are displayed
     uint8_t numItems = 0;
     CHECK_ERROR(parser_getNumItems(ctx, &numItems))
 
-    char tmpKey[MAX_ITEM_LENGTH_IN_PAGE] = {0};
-    char tmpVal[MAX_ITEM_LENGTH_IN_PAGE] = {0};
-
+    item_array_t *item_array = items_getItemArray();
     for (uint8_t idx = 0; idx < numItems; idx++) {
-        uint8_t pageCount = 0;
-        CHECK_ERROR(parser_getItem(ctx, idx, tmpKey, sizeof(tmpKey), tmpVal, sizeof(tmpVal), 0, &pageCount))
+        // Unknown capabilities were measured when stored, those left out only show their name
+        const item_t item = item_array->items[idx];
+        if (item.key == key_unknown_capability && ITEM_CAN_DISPLAY(item)) {
+            continue;
+        }
+
+        uint32_t valueLen = 0;
+        ITEMS_TO_PARSER_ERROR(items_measure(item, &valueLen))
+        if (valueLen > MAX_ITEM_LENGTH_TO_DISPLAY) {
+            return parser_value_out_of_range;
+        }
     }
     return parser_ok;
 }
@@ -126,7 +205,6 @@ parser_error_t parser_getItem(const parser_context_t *ctx, uint8_t displayIdx, c
     *pageCount = 1;
     uint8_t numItems = 0;
     item_array_t *item_array = items_getItemArray();
-    char tempVal[300] = {0};
     CHECK_ERROR(parser_getNumItems(ctx, &numItems))
     CHECK_APP_CANARY()
 
@@ -134,31 +212,39 @@ parser_error_t parser_getItem(const parser_context_t *ctx, uint8_t displayIdx, c
     cleanOutput(outKey, outKeyLen, outVal, outValLen);
     CHECK_ERROR(parser_getItemKey(displayIdx, outKey, outKeyLen))
 
-    ITEMS_TO_PARSER_ERROR(item_array->toString[displayIdx](item_array->items[displayIdx], tempVal, sizeof(tempVal)));
-    pageString(outVal, outValLen, tempVal, pageIdx, pageCount);
+    parser_renderCacheAdd(displayIdx, item_array->items[displayIdx]);
+    if (parser_renderCacheHas(displayIdx)) {
+        const uint16_t start = render_cache.start[displayIdx];
+        pageStringExt(outVal, outValLen, render_cache.data + start, render_cache.end[displayIdx] - start, pageIdx,
+                      pageCount);
+        return parser_ok;
+    }
 
-    return parser_ok;
-}
+    // Not cached: render the value again and only keep the bytes of the requested page
+    const item_formatter_t formatter = items_getFormatter(item_array->items[displayIdx].key);
+    if (formatter == NULL || outValLen < 2) {
+        return parser_unexpected_error;
+    }
 
-static parser_error_t parser_getItemKey(uint8_t displayIdx, char *outKey, uint16_t outKeyLen) {
-    item_array_t *item_array = items_getItemArray();
-    static uint8_t transfer_count = 0;
-    static uint8_t unk_cap_count = 0;
-    static uint8_t last_displayIdx = 0;
-    bool update_counts = false;
+    MEMZERO(outVal, outValLen);
+    const uint16_t pageLen = outValLen - 1;
+    item_writer_t writer;
+    items_writerInit(&writer, outVal, pageLen, (uint32_t)pageIdx * pageLen);
+    ITEMS_TO_PARSER_ERROR(formatter(item_array->items[displayIdx], &writer))
 
-    if (displayIdx == 0) {
-        transfer_count = 0;
-        unk_cap_count = 0;
+    const uint32_t numPages = (writer.valueLen + pageLen - 1) / pageLen;
+    if (numPages > UINT8_MAX) {
+        return parser_value_out_of_range;
     }
+    *pageCount = (uint8_t)numPages;
 
-    if (last_displayIdx != displayIdx) {
-        update_counts = true;
-    }
+    return parser_ok;
+}
 
-    last_displayIdx = displayIdx;
+static parser_error_t parser_getItemKey(uint8_t displayIdx, char *outKey, uint16_t outKeyLen) {
+    const item_t *item = &items_getItemArray()->items[displayIdx];
 
-    switch (item_array->items[displayIdx].key) {
+    switch (item->key) {
         case key_signing:
             strncpy(outKey, "Signing", outKeyLen);
             break;
@@ -175,6 +261,9 @@ static parser_error_t parser_getItemKey(uint8_t displayIdx, char *outKey, uint16
             strncpy(outKey, "Unscoped Signer", outKeyLen);
             break;
         case key_warning:
+        case key_hash_warning:
+        case key_tx_too_large:
+        case key_signer_unknown:
             strncpy(outKey, "WARNING", outKeyLen);
             break;
         case key_caution:
@@ -205,19 +294,20 @@ static parser_error_t parser_getItemKey(uint8_t displayIdx, char *outKey, uint16
             strncpy(outKey, "To Chain", outKeyLen);
             break;
         case key_transfer:
-            if (update_counts) {
-                transfer_count++;
-            }
-            snprintf(outKey, outKeyLen, "Transfer %d", transfer_count);
+        case key_cross_transfer:
+            snprintf(outKey, outKeyLen, "Transfer %d", item->ordinal);
             break;
         case key_rotate:
             strncpy(outKey, "Rotate for account", outKeyLen);
             break;
         case key_unknown_capability:
-            if (update_counts) {
-                unk_cap_count++;
-            }
-            snprintf(outKey, outKeyLen, "Unknown Capability %d", unk_cap_count);
+            snprintf(outKey, outKeyLen, "Unknown Capability %d", item->ordinal);
+            break;
+        case key_transfer_summary:
+            snprintf(outKey, outKeyLen, "To %d", item->ordinal);
+            break;
+        case key_transfer_total:
+            strncpy(outKey, "Total", outKeyLen);
             break;
         case key_transaction_hash:
             strncpy(outKey, "Transaction hash", outKeyLen);
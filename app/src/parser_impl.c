@@ -53,20 +53,115 @@
 #define NONCE_LEN 32
 #define TTL_LEN 20
 
+// Deepest nesting of the transfer template: clist capability args
+#define TEMPLATE_MAX_DEPTH 6
+
+// Writes the transfer template. Its shape is fixed, so the tokens jsmn would produce for it are recorded
+// while it is written, and the template does not need to be tokenized again
+typedef struct {
+    jsmntok_t *tokens;
+    uint16_t numTokens;
+    uint16_t open[TEMPLATE_MAX_DEPTH];
+    uint8_t depth;
+    // Set when a field would not be tokenized as the template expects, the recorded tokens are then dropped
+    bool untokenized;
+} template_writer_t;
+
 #define CMP_STRING_AND_BUFFER(str, buffer, len) (len == strlen(str) && MEMCMP(str, buffer, len) == 0)
 
 static parser_error_t parser_readSingleByte(parser_context_t *ctx, uint8_t *byte);
 static parser_error_t parser_readBytes(parser_context_t *ctx, uint8_t **bytes, uint16_t len);
-static parser_error_t parser_formatTxTransfer(uint16_t address_len, char *address, chunk_t *chunks, uint8_t tx_type);
 static parser_error_t parser_validate_chunks(chunk_t *chunks);
+static parser_error_t parser_indexCommand(tx_json_t *tx_json);
+static parser_error_t parser_getDeviceKeyHex(char *address, uint16_t addressSize, uint16_t *addressLen);
+static parser_error_t parser_createJsonTemplate(parser_context_t *ctx);
+static parser_error_t parser_formatTxTransfer(template_writer_t *w, uint16_t address_len, char *address, chunk_t *chunks,
+                                              uint8_t tx_type);
+
+const json_key_t json_key_network_id = JSON_KEY(JSON_NETWORK_ID, 0xEB);
+const json_key_t json_key_payload = JSON_KEY(JSON_PAYLOAD, 0xFE);
+const json_key_t json_key_nonce = JSON_KEY(JSON_NONCE, 0x53);
+const json_key_t json_key_meta = JSON_KEY(JSON_META, 0x6D);
+const json_key_t json_key_signers = JSON_KEY(JSON_SIGNERS, 0x53);
+const json_key_t json_key_pubkey = JSON_KEY(JSON_PUBKEY, 0xC2);
+const json_key_t json_key_clist = JSON_KEY(JSON_CLIST, 0xFD);
+const json_key_t json_key_args = JSON_KEY(JSON_ARGS, 0xF9);
+const json_key_t json_key_name = JSON_KEY(JSON_NAME, 0x9B);
+const json_key_t json_key_creation_time = JSON_KEY(JSON_CREATION_TIME, 0x78);
+const json_key_t json_key_ttl = JSON_KEY(JSON_TTL, 0x1C);
+const json_key_t json_key_chain_id = JSON_KEY(JSON_CHAIN_ID, 0x34);
+const json_key_t json_key_gas_limit = JSON_KEY(JSON_GAS_LIMIT, 0x24);
+const json_key_t json_key_gas_price = JSON_KEY(JSON_GAS_PRICE, 0x1E);
+const json_key_t json_key_sender = JSON_KEY(JSON_SENDER, 0x7D);
+const json_key_t json_key_decimal = JSON_KEY(JSON_DECIMAL, 0x67);
+
+// The payload is covered by the hash but never displayed, so it does not need tokens
+static const json_key_t *const cmd_opaque_key_list[] = {&json_key_payload};
+const json_opaque_keys_t cmd_opaque_keys = {cmd_opaque_key_list,
+                                            sizeof(cmd_opaque_key_list) / sizeof(cmd_opaque_key_list[0])};
+
+typedef struct {
+    const json_key_t *key;
+    cmd_field_t field;
+} cmd_field_key_t;
+
+static const cmd_field_key_t cmd_top_level_keys[] = {
+    {&json_key_network_id, cmd_field_network_id}, {&json_key_payload, cmd_field_payload},
+    {&json_key_signers, cmd_field_signers},       {&json_key_meta, cmd_field_meta},
+    {&json_key_nonce, cmd_field_nonce},
+};
+
+static const cmd_field_key_t cmd_meta_keys[] = {
+    {&json_key_creation_time, cmd_field_creation_time}, {&json_key_ttl, cmd_field_ttl},
+    {&json_key_gas_limit, cmd_field_gas_limit},         {&json_key_chain_id, cmd_field_chain_id},
+    {&json_key_gas_price, cmd_field_gas_price},         {&json_key_sender, cmd_field_sender},
+};
+
+// Capabilities with a dedicated display. Names are matched on their length and hash before any byte is compared
+typedef struct {
+    json_key_t name;
+    parser_error_t tx_name;
+    uint8_t num_args;
+} cap_name_t;
+
+#define CAP_ANY_ARGS 0xFF
+
+static const cap_name_t cap_names[] = {
+    {JSON_KEY("coin.TRANSFER", 0x22), parser_name_tx_transfer, 3},
+    {JSON_KEY("coin.TRANSFER_XCHAIN", 0x22), parser_name_tx_transfer_xchain, 4},
+    {JSON_KEY("coin.ROTATE", 0x4A), parser_name_rotate, 1},
+    {JSON_KEY("coin.GAS", 0x6A), parser_name_gas, CAP_ANY_ARGS},
+};
+
+// Transfers of any fungible-v2 token, <namespace>.<module><suffix>. Suffixes are compared byte by byte
+typedef struct {
+    uint8_t len;
+    const char *str;
+    parser_error_t tx_name;
+    uint8_t num_args;
+} cap_suffix_t;
+
+#define CAP_SUFFIX(__str) sizeof(__str) - 1, __str
+
+static const cap_suffix_t cap_fungible_suffixes[] = {
+    {CAP_SUFFIX(".TRANSFER"), parser_name_tx_transfer, 3},
+    {CAP_SUFFIX(".TRANSFER_XCHAIN"), parser_name_tx_transfer_xchain, 4},
+};
 
 tx_json_t *parser_json_obj;
 tx_hash_t *parser_hash_obj;
 
-parser_error_t _read_json_tx(parser_context_t *c) {
-    parser_json_obj = c->json;
+static parser_error_t parser_tokenizeJson(parser_context_t *c) {
+    // Tokens that do not fit in parsed_json_t go to the part of the RAM buffer the tx is not using
+    json_parse_config_t config = {&cmd_opaque_keys, NULL, 0};
+    config.spill = tx_get_spill_buffer(&config.spillLen);
 
-    CHECK_ERROR(json_parse(&(parser_json_obj->json), (const char *)c->buffer, c->bufferLen));
+    // Completes the tokenization started while the chunks were received, if any
+    return json_parse_stream_finish(&(parser_json_obj->json), (const char *)c->buffer, c->bufferLen, &config);
+}
+
+static parser_error_t parser_readJsonCommand(parser_context_t *c) {
+    CHECK_ERROR(parser_indexCommand(parser_json_obj));
 
     parser_json_obj->tx = (const char *)c->buffer;
     parser_json_obj->flags.cache_valid = 0;
@@ -75,6 +170,18 @@ parser_error_t _read_json_tx(parser_context_t *c) {
     return parser_ok;
 }
 
+parser_error_t _read_json_tx(parser_context_t *c) {
+    parser_json_obj = c->json;
+    CHECK_ERROR(parser_tokenizeJson(c));
+    return parser_readJsonCommand(c);
+}
+
+parser_error_t _read_json_template_tx(parser_context_t *c) {
+    parser_json_obj = c->json;
+    CHECK_ERROR(parser_createJsonTemplate(c));
+    return parser_readJsonCommand(c);
+}
+
 parser_error_t _read_hash_tx(parser_context_t *c) {
     if (c->bufferLen != HASH_LEN) {
         return parser_unexpected_buffer_end;
@@ -92,45 +199,147 @@ parser_error_t _read_hash_tx(parser_context_t *c) {
 
 tx_json_t *parser_getParserJsonObj() { return parser_json_obj; }
 
+const kadena_cmd_index_t *parser_getCmdIndex() { return &parser_json_obj->cmd; }
+
 tx_hash_t *parser_getParserHashObj() { return parser_hash_obj; }
 
-parser_error_t parser_findPubKeyInClist(uint16_t key_token_index) {
-    parsed_json_t *json_all = &parser_json_obj->json;
-    uint16_t token_index = 0;
-    uint16_t clist_token_index = 0;
-    uint16_t args_token_index = 0;
-    uint16_t number_of_args = 0;
-    uint16_t clist_element_count = 0;
-    jsmntok_t *value_token = NULL;
-    jsmntok_t *key_token = NULL;
+// FNV-1a of the hex characters of a key, used to reject most keys without comparing them
+static uint32_t parser_keyDigest(const char *hex) {
+    uint32_t digest = 0x811C9DC5u;
+    for (uint8_t i = 0; i < KEY_HEX_LEN; i++) {
+        digest = (digest ^ (uint8_t)hex[i]) * 0x01000193u;
+    }
+    return digest;
+}
 
-    if (parser_getValidClist(&clist_token_index, &clist_element_count) != parser_ok) {
-        return parser_no_data;
+// Hex characters of the key held by a string token, NULL when the token is not a key
+static const char *parser_getKeyHex(const parsed_json_t *json, uint16_t token_index) {
+    const jsmntok_t *token = json_get_token(json, token_index);
+    const char *data = json->buffer + JSMN_TOKEN_START(token);
+    uint16_t len = JSMN_TOKEN_LEN(token);
+
+    if (JSMN_TOKEN_TYPE(token) != JSMN_STRING) {
+        return NULL;
+    }
+    // Key could possibly be prefixed with "k:"
+    if (len == KEY_HEX_LEN + 2 && CMP_STRING_AND_BUFFER("k:", data, 2)) {
+        data += 2;
+        len -= 2;
+    }
+    if (len != KEY_HEX_LEN) {
+        return NULL;
     }
+    for (uint8_t i = 0; i < KEY_HEX_LEN; i++) {
+        const char c = data[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+            return NULL;
+        }
+    }
+    return data;
+}
 
-    for (uint16_t i = 0; i < clist_element_count; i++) {
-        CHECK_ERROR(array_get_nth_element(json_all, clist_token_index, i, &args_token_index));
-        CHECK_ERROR(object_get_value(json_all, args_token_index, JSON_ARGS, &args_token_index));
-        CHECK_ERROR(array_get_element_count(json_all, args_token_index, &number_of_args));
+// Calls visit on every key arg of the clist of a signer, stops when it returns true
+typedef bool (*parser_key_visitor_t)(const parsed_json_t *json, uint16_t token_index, const char *hex, void *ctx);
 
-        for (uint16_t j = 0; j < number_of_args; j++) {
-            array_get_nth_element(json_all, args_token_index, j, &token_index);
-            value_token = &(json_all->tokens[token_index]);
-            key_token = &(json_all->tokens[key_token_index]);
-            uint8_t offset = 0;
+static bool parser_walkClistKeys(const parsed_json_t *json, const cmd_signer_t *signer, parser_key_visitor_t visit,
+                                 void *ctx) {
+    json_iter_t clist_iter;
+    json_iter_t args_iter;
+    uint16_t cap_token_index = 0;
+    uint16_t args_token_index = 0;
+    uint16_t token_index = 0;
 
-            // Key could possibly be prefixed with "k:"
-            if (CMP_STRING_AND_BUFFER("k:", json_all->buffer + value_token->start, 2)) {
-                offset = 2;
-            }
+    if ((signer->present & SIGNER_CLIST_BIT) == 0 || (signer->null & SIGNER_CLIST_BIT) != 0 ||
+        json_array_iter_begin(json, signer->clist, &clist_iter) != parser_ok) {
+        return false;
+    }
 
-            if (MEMCMP(json_all->buffer + key_token->start, json_all->buffer + value_token->start + offset,
-                       key_token->end - key_token->start) == 0) {
-                return parser_ok;
+    while (json_array_iter_next(json, &clist_iter, &cap_token_index) == parser_ok) {
+        if (object_get_value_by_key(json, cap_token_index, &json_key_args, &args_token_index) != parser_ok ||
+            json_array_iter_begin(json, args_token_index, &args_iter) != parser_ok) {
+            continue;
+        }
+        while (json_array_iter_next(json, &args_iter, &token_index) == parser_ok) {
+            const char *hex = parser_getKeyHex(json, token_index);
+            if (hex != NULL && visit(json, token_index, hex, ctx)) {
+                return true;
             }
         }
     }
 
+    return false;
+}
+
+typedef struct {
+    kadena_cmd_index_t *cmd;
+    uint8_t signer;
+} parser_key_index_ctx_t;
+
+static bool parser_addClistKey(__Z_UNUSED const parsed_json_t *json, uint16_t token_index, const char *hex,
+                               void *ctx) {
+    parser_key_index_ctx_t *index = (parser_key_index_ctx_t *)ctx;
+    kadena_cmd_index_t *cmd = index->cmd;
+
+    if (cmd->numberOfClistKeys >= MAX_NUMBER_OF_CLIST_KEYS) {
+        cmd->clistKeysOverflow = true;
+        return true;
+    }
+
+    cmd_clist_key_t *key = &cmd->clistKeys[cmd->numberOfClistKeys++];
+    key->digest = parser_keyDigest(hex);
+    key->token = token_index;
+    key->signer = index->signer;
+    return false;
+}
+
+static bool parser_matchKey(__Z_UNUSED const parsed_json_t *json, __Z_UNUSED uint16_t token_index, const char *hex,
+                            void *ctx) {
+    return MEMCMP(hex, (const char *)ctx, KEY_HEX_LEN) == 0;
+}
+
+// Digest of every key arg in the clists, so signer scoping is answered without walking them again
+static void parser_indexClistKeys(const parsed_json_t *json, kadena_cmd_index_t *cmd) {
+    parser_key_index_ctx_t ctx = {cmd, 0};
+    const uint8_t numberOfSigners =
+        (cmd->numberOfSigners < MAX_NUMBER_OF_SIGNERS) ? (uint8_t)cmd->numberOfSigners : MAX_NUMBER_OF_SIGNERS;
+
+    for (ctx.signer = 0; ctx.signer < numberOfSigners && !cmd->clistKeysOverflow; ctx.signer++) {
+        parser_walkClistKeys(json, &cmd->signers[ctx.signer], parser_addClistKey, &ctx);
+    }
+}
+
+parser_error_t parser_isSignerScoped(uint8_t signer_index) {
+    const parsed_json_t *json_all = &parser_json_obj->json;
+    const kadena_cmd_index_t *cmd = &parser_json_obj->cmd;
+
+    if (signer_index >= cmd->numberOfSigners || signer_index >= MAX_NUMBER_OF_SIGNERS) {
+        return parser_no_data;
+    }
+
+    const cmd_signer_t *signer = &cmd->signers[signer_index];
+    if ((signer->present & SIGNER_PUBKEY_BIT) == 0 || (signer->null & SIGNER_PUBKEY_BIT) != 0) {
+        return parser_no_data;
+    }
+
+    const char *pubkey = parser_getKeyHex(json_all, signer->pubKey);
+    if (pubkey == NULL) {
+        return parser_no_data;
+    }
+
+    const uint32_t digest = parser_keyDigest(pubkey);
+    for (uint8_t i = 0; i < cmd->numberOfClistKeys; i++) {
+        const cmd_clist_key_t *key = &cmd->clistKeys[i];
+        if (key->signer == signer_index && key->digest == digest &&
+            MEMCMP(parser_getKeyHex(json_all, key->token), pubkey, KEY_HEX_LEN) == 0) {
+            return parser_ok;
+        }
+    }
+
+    // Only the keys that did not fit in the index are left to check
+    if (cmd->clistKeysOverflow && parser_walkClistKeys(json_all, signer, parser_matchKey, (void *)pubkey)) {
+        return parser_ok;
+    }
+
     return parser_no_data;
 }
 
@@ -138,7 +347,7 @@ parser_error_t parser_arrayElementToString(uint16_t json_token_index, uint16_t e
                                            uint8_t *outValLen) {
     uint16_t token_index = 0;
     parsed_json_t *json_all = &(parser_json_obj->json);
-    jsmntok_t *token = NULL;
+    const jsmntok_t *token = NULL;
     uint16_t element_count = 0;
 
     CHECK_ERROR(array_get_element_count(json_all, json_token_index, &element_count));
@@ -147,116 +356,375 @@ parser_error_t parser_arrayElementToString(uint16_t json_token_index, uint16_t e
     }
 
     CHECK_ERROR(array_get_nth_element(json_all, json_token_index, element_idx, &token_index));
-    token = &(json_all->tokens[token_index]);
+    token = json_get_token(json_all, token_index);
 
-    *outVal = json_all->buffer + token->start;
-    *outValLen = token->end - token->start;
+    *outVal = json_all->buffer + JSMN_TOKEN_START(token);
+    *outValLen = JSMN_TOKEN_LEN(token);
 
     return parser_ok;
 }
 
 parser_error_t parser_validateMetaField() {
-    const char *keywords[20] = {JSON_CREATION_TIME, JSON_TTL, JSON_GAS_LIMIT, JSON_CHAIN_ID, JSON_GAS_PRICE, JSON_SENDER};
-    char meta_curr_key[40];
-    uint16_t meta_token_index = 0;
-    uint16_t meta_num_elements = 0;
-    uint16_t key_token_idx = 0;
-    parsed_json_t *json_all = &(parser_json_obj->json);
-    jsmntok_t *token = NULL;
+    const kadena_cmd_index_t *cmd = &parser_json_obj->cmd;
 
-    CHECK_ERROR(object_get_value(json_all, 0, JSON_META, &meta_token_index));
-
-    if (items_isNullField(meta_token_index)) {
+    if (!CMD_HAS_FIELD(cmd, cmd_field_meta) || CMD_IS_NULL(cmd, cmd_field_meta)) {
         return parser_no_data;
     }
 
-    object_get_element_count(json_all, meta_token_index, &meta_num_elements);
+    // The keys were matched while indexing the command, in any order
+    if (cmd->metaUnexpected || (cmd->present & CMD_META_FIELDS) != CMD_META_FIELDS) {
+        return parser_invalid_meta_field;
+    }
 
-    for (uint16_t i = 0; i < meta_num_elements; i++) {
-        object_get_nth_key(json_all, meta_token_index, i, &key_token_idx);
-        token = &(json_all->tokens[key_token_idx]);
+    return parser_ok;
+}
 
-        // Prevent buffer overflow in case of big key-value pair in meta field.
-        if (token->end - token->start >= sizeof(meta_curr_key)) {
-            return parser_invalid_meta_field;
+// Length of the module reference of a fungible transfer name, 0 when it is not <namespace>.<module><suffix>
+static uint16_t parser_fungibleModuleLen(const char *name, uint16_t len, const cap_suffix_t *suffix) {
+    if (len <= suffix->len || MEMCMP(name + len - suffix->len, (const char *)PIC(suffix->str), suffix->len) != 0) {
+        return 0;
+    }
+
+    const uint16_t module_len = len - suffix->len;
+    uint8_t dots = 0;
+    for (uint16_t i = 0; i < module_len; i++) {
+        if (name[i] == '.') {
+            // Both the namespace and the module must be non-empty
+            if (i == 0 || i == module_len - 1) {
+                return 0;
+            }
+            dots++;
         }
+    }
 
-        MEMCPY(meta_curr_key, json_all->buffer + token->start, token->end - token->start);
-        meta_curr_key[token->end - token->start] = '\0';
+    return (dots == 1) ? module_len : 0;
+}
 
-        if (strcmp(keywords[i], meta_curr_key) != 0) {
-            return parser_invalid_meta_field;
+// Scans the two small tables: known names are rejected on their length and hash, then fungible suffixes are compared.
+// Only keys are hashed by the JSON parser, the name value is hashed here once for the whole table
+static bool parser_lookupCapName(const parsed_json_t *json, uint16_t name_token_index, parser_error_t *tx_name,
+                                 uint8_t *num_args) {
+    const jsmntok_t *token = json_get_token(json, name_token_index);
+    const char *name = json->buffer + JSMN_TOKEN_START(token);
+    const uint16_t name_len = JSMN_TOKEN_LEN(token);
+    const uint8_t hash = json_key_hash(name, name_len);
+
+    for (uint8_t i = 0; i < sizeof(cap_names) / sizeof(cap_names[0]); i++) {
+        if (json_key_matches(&cap_names[i].name, name, name_len, hash)) {
+            *tx_name = cap_names[i].tx_name;
+            *num_args = cap_names[i].num_args;
+            return true;
         }
+    }
 
-        MEMZERO(meta_curr_key, sizeof(meta_curr_key));
+    for (uint8_t i = 0; i < sizeof(cap_fungible_suffixes) / sizeof(cap_fungible_suffixes[0]); i++) {
+        if (parser_fungibleModuleLen(name, name_len, &cap_fungible_suffixes[i]) > 0) {
+            *tx_name = cap_fungible_suffixes[i].tx_name;
+            *num_args = cap_fungible_suffixes[i].num_args;
+            return true;
+        }
     }
 
-    return parser_ok;
+    return false;
 }
 
 parser_error_t parser_getTxName(uint16_t token_index) {
     parsed_json_t *json_all = &(parser_json_obj->json);
+    uint16_t name_token_index = 0;
+    uint16_t args_token_index = 0;
+    uint16_t num_args = 0;
 
-    if (object_get_value(json_all, token_index, JSON_NAME, &token_index) == parser_ok) {
-        uint16_t len = 0;
-        jsmntok_t *token = NULL;
-
-        token = &(json_all->tokens[token_index]);
+    if (object_get_value_by_key(json_all, token_index, &json_key_name, &name_token_index) != parser_ok) {
+        return parser_no_data;
+    }
 
-        len = token->end - token->start;
+    parser_error_t tx_name = parser_no_data;
+    uint8_t expected_args = 0;
+    if (!parser_lookupCapName(json_all, name_token_index, &tx_name, &expected_args)) {
+        return parser_no_data;
+    }
 
-        if (len == 0) {
+    // A known name with unexpected args is shown as an unknown capability
+    if (expected_args != CAP_ANY_ARGS) {
+        if (object_get_value_by_key(json_all, token_index, &json_key_args, &args_token_index) != parser_ok ||
+            array_get_element_count(json_all, args_token_index, &num_args) != parser_ok || num_args != expected_args) {
             return parser_no_data;
         }
+    }
 
-        if (CMP_STRING_AND_BUFFER("coin.TRANSFER", json_all->buffer + token->start, len)) {
-            return parser_name_tx_transfer;
-        }
-        if (CMP_STRING_AND_BUFFER("coin.TRANSFER_XCHAIN", json_all->buffer + token->start, len)) {
-            return parser_name_tx_transfer_xchain;
-        }
-        if (CMP_STRING_AND_BUFFER("coin.ROTATE", json_all->buffer + token->start, len)) {
-            return parser_name_rotate;
-        }
-        if (CMP_STRING_AND_BUFFER("coin.GAS", json_all->buffer + token->start, len)) {
-            return parser_name_gas;
+    return tx_name;
+}
+
+parser_error_t parser_getTxModule(uint16_t token_index, const char **module, uint16_t *module_len) {
+    parsed_json_t *json_all = &(parser_json_obj->json);
+    uint16_t name_token_index = 0;
+
+    CHECK_ERROR(object_get_value_by_key(json_all, token_index, &json_key_name, &name_token_index))
+    const jsmntok_t *token = json_get_token(json_all, name_token_index);
+    const char *name = json_all->buffer + JSMN_TOKEN_START(token);
+
+    *module = NULL;
+    *module_len = 0;
+    for (uint8_t i = 0; i < sizeof(cap_fungible_suffixes) / sizeof(cap_fungible_suffixes[0]); i++) {
+        const uint16_t len = parser_fungibleModuleLen(name, JSMN_TOKEN_LEN(token), &cap_fungible_suffixes[i]);
+        if (len > 0) {
+            *module = name;
+            *module_len = len;
+            return parser_ok;
         }
     }
 
     return parser_no_data;
 }
 
-parser_error_t parser_getValidClist(uint16_t *clist_token_index, uint16_t *num_args) {
+// Unsigned decimal without exponent, with at most TRANSFER_AMOUNT_MAX_INT_DIGITS.TRANSFER_AMOUNT_MAX_FRAC_DIGITS digits
+static bool parser_isPlainDecimal(const char *data, uint16_t len) {
+    uint16_t int_digits = 0;
+    uint16_t frac_digits = 0;
+    bool has_dot = false;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] == '.' && !has_dot) {
+            has_dot = true;
+        } else if (data[i] < '0' || data[i] > '9') {
+            return false;
+        } else if (has_dot) {
+            frac_digits++;
+        } else {
+            int_digits++;
+        }
+    }
+
+    return int_digits > 0 && int_digits <= TRANSFER_AMOUNT_MAX_INT_DIGITS && (!has_dot || frac_digits > 0) &&
+           frac_digits <= TRANSFER_AMOUNT_MAX_FRAC_DIGITS;
+}
+
+parser_error_t parser_getTransferAmount(uint16_t token_index, const char **amount, uint16_t *amount_len) {
     parsed_json_t *json_all = &(parser_json_obj->json);
 
-    CHECK_ERROR(object_get_value(json_all, 0, JSON_SIGNERS, clist_token_index));
+    CHECK_ERROR(object_get_value_by_key(json_all, token_index, &json_key_args, &token_index))
+    CHECK_ERROR(array_get_nth_element(json_all, token_index, 2, &token_index))
+
+    // Large amounts are sent as {"decimal": "<digits>"}
+    if (JSMN_TOKEN_TYPE(json_get_token(json_all, token_index)) == JSMN_OBJECT) {
+        CHECK_ERROR(object_get_value_by_key(json_all, token_index, &json_key_decimal, &token_index))
+    }
 
-    if (!items_isNullField(*clist_token_index)) {
-        CHECK_ERROR(array_get_nth_element(json_all, *clist_token_index, 0, clist_token_index));
+    const jsmntok_t *token = json_get_token(json_all, token_index);
+    *amount = json_all->buffer + JSMN_TOKEN_START(token);
+    *amount_len = JSMN_TOKEN_LEN(token);
 
-        if (object_get_value(json_all, *clist_token_index, JSON_CLIST, clist_token_index) == parser_ok) {
-            if (!items_isNullField(*clist_token_index)) {
-                CHECK_ERROR(array_get_element_count(json_all, *clist_token_index, num_args));
-                return parser_ok;
-            }
-        }
+    return parser_isPlainDecimal(*amount, *amount_len) ? parser_ok : parser_unexpected_value;
+}
+
+bool parser_isSameTransferGroup(uint16_t token_index_a, uint16_t token_index_b) {
+    parsed_json_t *json_all = &(parser_json_obj->json);
+    uint16_t sender_a = 0;
+    uint16_t sender_b = 0;
+    const char *module_a = NULL;
+    const char *module_b = NULL;
+    uint16_t module_a_len = 0;
+    uint16_t module_b_len = 0;
+
+    if (object_get_value_by_key(json_all, token_index_a, &json_key_args, &sender_a) != parser_ok ||
+        array_get_nth_element(json_all, sender_a, 0, &sender_a) != parser_ok ||
+        object_get_value_by_key(json_all, token_index_b, &json_key_args, &sender_b) != parser_ok ||
+        array_get_nth_element(json_all, sender_b, 0, &sender_b) != parser_ok) {
+        return false;
     }
 
-    return parser_no_data;
+    const jsmntok_t *token_a = json_get_token(json_all, sender_a);
+    const jsmntok_t *token_b = json_get_token(json_all, sender_b);
+    if (JSMN_TOKEN_LEN(token_a) != JSMN_TOKEN_LEN(token_b) ||
+        MEMCMP(json_all->buffer + JSMN_TOKEN_START(token_a), json_all->buffer + JSMN_TOKEN_START(token_b),
+               JSMN_TOKEN_LEN(token_a)) != 0) {
+        return false;
+    }
+
+    // Amounts of different tokens are never added up; coin has no module reference
+    parser_getTxModule(token_index_a, &module_a, &module_a_len);
+    parser_getTxModule(token_index_b, &module_b, &module_b_len);
+    return module_a_len == module_b_len && (module_a_len == 0 || MEMCMP(module_a, module_b, module_a_len) == 0);
+}
+
+parser_error_t parser_getValidClist(uint16_t *clist_token_index, uint16_t *num_args) {
+    const kadena_cmd_index_t *cmd = &parser_json_obj->cmd;
+
+    if (!CMD_HAS_FIELD(cmd, cmd_field_signers) || CMD_IS_NULL(cmd, cmd_field_signers) || cmd->numberOfSigners == 0) {
+        return parser_no_data;
+    }
+
+    const cmd_signer_t *signer = &cmd->signers[cmd->deviceSigner];
+    if ((signer->present & SIGNER_CLIST_BIT) == 0 || (signer->null & SIGNER_CLIST_BIT) != 0) {
+        return parser_no_data;
+    }
+
+    *clist_token_index = signer->clist;
+    CHECK_ERROR(array_get_element_count(&(parser_json_obj->json), *clist_token_index, num_args));
+
+    return parser_ok;
 }
 
 bool items_isNullField(uint16_t json_token_index) {
     parsed_json_t *json_all = &(parser_getParserJsonObj()->json);
-    jsmntok_t *token = &(json_all->tokens[json_token_index]);
+    const jsmntok_t *token = json_get_token(json_all, json_token_index);
 
-    if (token->end - token->start != sizeof("null") - 1) {
+    if (JSMN_TOKEN_LEN(token) != sizeof("null") - 1) {
         return false;
     }
 
-    return CMP_STRING_AND_BUFFER("null", json_all->buffer + token->start, token->end - token->start);
+    return CMP_STRING_AND_BUFFER("null", json_all->buffer + JSMN_TOKEN_START(token), JSMN_TOKEN_LEN(token));
+}
+
+static bool parser_matchFieldKey(const parsed_json_t *json, uint16_t key_token_index, const cmd_field_key_t *keys,
+                                 uint8_t keys_len, cmd_field_t *field) {
+    for (uint8_t i = 0; i < keys_len; i++) {
+        if (json_token_equals_key(json, key_token_index, (const json_key_t *)PIC(keys[i].key))) {
+            *field = keys[i].field;
+            return true;
+        }
+    }
+    return false;
 }
 
-parser_error_t parser_createJsonTemplate(parser_context_t *ctx) {
+static void parser_storeField(kadena_cmd_index_t *cmd, cmd_field_t field, uint16_t value_token_index) {
+    // Only the first occurrence of a key counts, same as object_get_value_by_key
+    if (CMD_HAS_FIELD(cmd, field)) {
+        return;
+    }
+    cmd->token[field] = value_token_index;
+    cmd->present |= CMD_FIELD_BIT(field);
+    if (items_isNullField(value_token_index)) {
+        cmd->null |= CMD_FIELD_BIT(field);
+    }
+}
+
+static parser_error_t parser_indexSigner(const parsed_json_t *json, uint16_t signer_token_index, cmd_signer_t *signer) {
+    json_iter_t signer_iter;
+    uint16_t key_index = 0;
+    uint16_t value_index = 0;
+
+    // Malformed signers are left empty and reported by the consumers
+    if (json_object_iter_begin(json, signer_token_index, &signer_iter) != parser_ok) {
+        return parser_ok;
+    }
+    while (json_object_iter_next(json, &signer_iter, &key_index, &value_index) == parser_ok) {
+        uint8_t bit = 0;
+        uint16_t *target = NULL;
+
+        if (json_token_equals_key(json, key_index, &json_key_pubkey)) {
+            bit = SIGNER_PUBKEY_BIT;
+            target = &signer->pubKey;
+        } else if (json_token_equals_key(json, key_index, &json_key_clist)) {
+            bit = SIGNER_CLIST_BIT;
+            target = &signer->clist;
+        } else {
+            continue;
+        }
+
+        if ((signer->present & bit) == 0) {
+            *target = value_index;
+            signer->present |= bit;
+            if (items_isNullField(value_index)) {
+                signer->null |= bit;
+            }
+        }
+    }
+
+    return parser_ok;
+}
+
+// Compares hex characters with a lowercase hex string, ignoring the case of the former
+static bool parser_equalsHexLower(const char *hex, const char *lower, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        const char c = (hex[i] >= 'A' && hex[i] <= 'F') ? (char)(hex[i] - 'A' + 'a') : hex[i];
+        if (c != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find the signer the device signs for, so multi-signer commands show its key and capabilities.
+// When there are several signers and none matches, signers[0] is shown behind a warning
+static void parser_indexDeviceSigner(const parsed_json_t *json, kadena_cmd_index_t *cmd) {
+    char device_key[ADDRESS_HEX_LEN] = {0};
+    uint16_t device_key_len = 0;
+
+    cmd->deviceSigner = 0;
+    cmd->deviceSignerUnknown = cmd->numberOfSigners > 1;
+    if (parser_getDeviceKeyHex(device_key, sizeof(device_key), &device_key_len) != parser_ok ||
+        device_key_len != KEY_HEX_LEN) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < cmd->numberOfSigners && i < MAX_NUMBER_OF_SIGNERS; i++) {
+        const cmd_signer_t *signer = &cmd->signers[i];
+        if ((signer->present & SIGNER_PUBKEY_BIT) == 0 || (signer->null & SIGNER_PUBKEY_BIT) != 0) {
+            continue;
+        }
+
+        const jsmntok_t *token = json_get_token(json, signer->pubKey);
+        if (JSMN_TOKEN_LEN(token) == KEY_HEX_LEN &&
+            parser_equalsHexLower(json->buffer + JSMN_TOKEN_START(token), device_key, KEY_HEX_LEN)) {
+            cmd->deviceSigner = i;
+            cmd->deviceSignerUnknown = false;
+            return;
+        }
+    }
+}
+
+// Walks the command once and records where every field used by the items layer lives, so later
+// lookups do not have to search the top-level object again.
+static parser_error_t parser_indexCommand(tx_json_t *tx_json) {
+    const parsed_json_t *json = &tx_json->json;
+    kadena_cmd_index_t *cmd = &tx_json->cmd;
+    json_iter_t iter;
+    uint16_t key_index = 0;
+    uint16_t value_index = 0;
+    cmd_field_t field = cmd_field_count;
+
+    MEMZERO(cmd, sizeof(kadena_cmd_index_t));
+
+    if (json_object_iter_begin(json, 0, &iter) != parser_ok) {
+        return parser_ok;
+    }
+    while (json_object_iter_next(json, &iter, &key_index, &value_index) == parser_ok) {
+        if (parser_matchFieldKey(json, key_index, cmd_top_level_keys,
+                                 sizeof(cmd_top_level_keys) / sizeof(cmd_top_level_keys[0]), &field)) {
+            parser_storeField(cmd, field, value_index);
+        }
+    }
+
+    if (CMD_HAS_FIELD(cmd, cmd_field_meta) && !CMD_IS_NULL(cmd, cmd_field_meta) &&
+        json_object_iter_begin(json, cmd->token[cmd_field_meta], &iter) == parser_ok) {
+        while (json_object_iter_next(json, &iter, &key_index, &value_index) == parser_ok) {
+            if (!parser_matchFieldKey(json, key_index, cmd_meta_keys,
+                                      sizeof(cmd_meta_keys) / sizeof(cmd_meta_keys[0]), &field) ||
+                CMD_HAS_FIELD(cmd, field)) {
+                cmd->metaUnexpected = true;
+                continue;
+            }
+            parser_storeField(cmd, field, value_index);
+        }
+    }
+
+    if (CMD_HAS_FIELD(cmd, cmd_field_signers) && !CMD_IS_NULL(cmd, cmd_field_signers) &&
+        json_array_iter_begin(json, cmd->token[cmd_field_signers], &iter) == parser_ok) {
+        while (json_array_iter_next(json, &iter, &value_index) == parser_ok) {
+            if (cmd->numberOfSigners < MAX_NUMBER_OF_SIGNERS) {
+                CHECK_ERROR(parser_indexSigner(json, value_index, &cmd->signers[cmd->numberOfSigners]));
+            }
+            cmd->numberOfSigners++;
+        }
+        parser_indexClistKeys(json, cmd);
+        parser_indexDeviceSigner(json, cmd);
+    }
+
+    return parser_ok;
+}
+
+static parser_error_t parser_createJsonTemplate(parser_context_t *ctx) {
     uint8_t tx_type = 0;
     char address[ADDRESS_HEX_LEN] = {0};
     uint16_t address_len = 0;
@@ -278,7 +746,29 @@ parser_error_t parser_createJsonTemplate(parser_context_t *ctx) {
     }
 
     CHECK_ERROR(parser_validate_chunks(chunks));
+    CHECK_ERROR(parser_getDeviceKeyHex(address, sizeof(address), &address_len));
+    template_writer_t writer;
+    MEMZERO(&writer, sizeof(writer));
+    writer.tokens = parser_json_obj->json.tokens;
+
+    tx_json_start();
+    CHECK_ERROR(parser_formatTxTransfer(&writer, address_len, address, chunks, tx_type));
+    if (tx_json_finish() != zxerr_ok) {
+        return parser_unexpected_buffer_end;
+    }
+
+    ctx->buffer = tx_json_get_buffer();
+    ctx->bufferLen = (uint16_t)tx_json_get_buffer_length();
+    ctx->offset = 0;
+
+    if (writer.untokenized || writer.depth != 0) {
+        return parser_tokenizeJson(ctx);
+    }
+    return json_parse_generated(&parser_json_obj->json, (const char *)ctx->buffer, ctx->bufferLen, writer.numTokens);
+}
 
+// Public key of the current derivation path, in hex
+static parser_error_t parser_getDeviceKeyHex(char *address, uint16_t addressSize, uint16_t *addressLen) {
 #if defined(LEDGER_SPECIFIC)
     uint8_t pubkey[PUB_KEY_LENGTH] = {0};
     uint16_t pubkey_len = 0;
@@ -287,15 +777,11 @@ parser_error_t parser_createJsonTemplate(parser_context_t *ctx) {
         return parser_unexpected_error;
     }
 
-    address_len = array_to_hexstr(address, sizeof(address), pubkey, PUB_KEY_LENGTH);
+    *addressLen = array_to_hexstr(address, addressSize, pubkey, PUB_KEY_LENGTH);
 #else
     // Dummy address for cpp_test
-    address_len =
-        snprintf(address, sizeof(address), "%s", "1234567890123456789012345678901234567890123456789012345678901234");
+    *addressLen = snprintf(address, addressSize, "%s", "1234567890123456789012345678901234567890123456789012345678901234");
 #endif
-
-    CHECK_ERROR(parser_formatTxTransfer(address_len, address, chunks, tx_type));
-
     return parser_ok;
 }
 
@@ -319,7 +805,98 @@ static parser_error_t parser_readBytes(parser_context_t *ctx, uint8_t **bytes, u
     return parser_ok;
 }
 
-static parser_error_t parser_formatTxTransfer(uint16_t address_len, char *address, chunk_t *chunks, uint8_t tx_type) {
+#define TEMPLATE_RAW(__str) parser_templateRaw(__str, sizeof(__str) - 1)
+
+static void parser_templateRaw(const char *data, uint16_t len) { tx_json_append((uint8_t *)data, len); }
+
+static uint16_t parser_templatePos() { return (uint16_t)tx_json_get_buffer_length(); }
+
+static void parser_templateToken(template_writer_t *w, jsmntype_t type, uint16_t start, uint16_t end) {
+    if (w->numTokens >= MAX_NUMBER_OF_TOKENS) {
+        w->untokenized = true;
+        return;
+    }
+    jsmn_fill_token(&w->tokens[w->numTokens], type, start, end);
+    w->numTokens++;
+}
+
+// Field written inside a string, where only the template may place quotes and escapes
+static void parser_templateCheckString(template_writer_t *w, const char *data, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] == '\"' || data[i] == '\\' || data[i] == '\0') {
+            w->untokenized = true;
+            return;
+        }
+    }
+}
+
+// Field written as a primitive, it must be a single one for jsmn_parse_primitive
+static void parser_templateCheckPrimitive(template_writer_t *w, const char *data, uint16_t len) {
+    if (len == 0) {
+        w->untokenized = true;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] < 33 || data[i] > 126 || strchr("\"{[:,]}", data[i]) != NULL) {
+            w->untokenized = true;
+            return;
+        }
+    }
+}
+
+static void parser_templateOpen(template_writer_t *w, jsmntype_t type) {
+    if (w->depth >= TEMPLATE_MAX_DEPTH) {
+        w->untokenized = true;
+    } else {
+        w->open[w->depth++] = w->numTokens;
+    }
+    parser_templateToken(w, type, parser_templatePos(), 0xFFFF);
+    parser_templateRaw((type == JSMN_OBJECT) ? "{" : "[", 1);
+}
+
+static void parser_templateClose(template_writer_t *w, jsmntype_t type) {
+    parser_templateRaw((type == JSMN_OBJECT) ? "}" : "]", 1);
+    if (w->depth == 0) {
+        w->untokenized = true;
+        return;
+    }
+    const uint16_t token_index = w->open[--w->depth];
+    if (token_index < w->numTokens) {
+        jsmn_fill_token(&w->tokens[token_index], type, JSMN_TOKEN_START(&w->tokens[token_index]), parser_templatePos());
+    }
+}
+
+// Strings may be written in several parts, between parser_templateStringBegin and parser_templateStringEnd
+static uint16_t parser_templateStringBegin() {
+    TEMPLATE_RAW("\"");
+    return parser_templatePos();
+}
+
+static void parser_templateStringEnd(template_writer_t *w, uint16_t start) {
+    parser_templateToken(w, JSMN_STRING, start, parser_templatePos());
+    TEMPLATE_RAW("\"");
+}
+
+static void parser_templateString(template_writer_t *w, const char *data, uint16_t len) {
+    parser_templateCheckString(w, data, len);
+    const uint16_t start = parser_templateStringBegin();
+    parser_templateRaw(data, len);
+    parser_templateStringEnd(w, start);
+}
+
+static void parser_templatePrimitive(template_writer_t *w, const char *data, uint16_t len) {
+    parser_templateCheckPrimitive(w, data, len);
+    const uint16_t start = parser_templatePos();
+    parser_templateRaw(data, len);
+    parser_templateToken(w, JSMN_PRIMITIVE, start, parser_templatePos());
+}
+
+static void parser_templateKey(template_writer_t *w, const json_key_t *key) {
+    parser_templateString(w, (const char *)PIC(key->str), key->len);
+    TEMPLATE_RAW(":");
+}
+
+static parser_error_t parser_formatTxTransfer(template_writer_t *w, uint16_t address_len, char *address, chunk_t *chunks,
+                                              uint8_t tx_type) {
     if (address == NULL || chunks == NULL) {
         return parser_unexpected_value;
     }
@@ -331,90 +908,155 @@ static parser_error_t parser_formatTxTransfer(uint16_t address_len, char *addres
     } else {
         snprintf(namespace_and_module, sizeof(namespace_and_module), "%s", "coin");
     }
-
-    tx_json_append((uint8_t *)"{\"networkId\":\"", 14);
-    tx_json_append((uint8_t *)chunks[NETWORK_POS].data, chunks[NETWORK_POS].len);
-    tx_json_append((uint8_t *)"\",\"payload\":{\"exec\":{\"data\":", 28);
+    const uint16_t module_len = (uint16_t)strlen(namespace_and_module);
+
+    // The payload is opaque and written raw, its strings must still end where the template expects
+    parser_templateCheckString(w, chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
+    parser_templateCheckString(w, chunks[RECIPIENT_CHAIN_POS].data, chunks[RECIPIENT_CHAIN_POS].len);
+    parser_templateCheckString(w, chunks[AMOUNT_POS].data, chunks[AMOUNT_POS].len);
+    parser_templateCheckString(w, namespace_and_module, module_len);
+
+    parser_templateOpen(w, JSMN_OBJECT);
+    parser_templateKey(w, &json_key_network_id);
+    parser_templateString(w, chunks[NETWORK_POS].data, chunks[NETWORK_POS].len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_payload);
+    parser_templateOpen(w, JSMN_OBJECT);
+    TEMPLATE_RAW("\"exec\":{\"data\":");
 
     if (tx_type == TX_TYPE_TRANSFER) {
-        tx_json_append((uint8_t *)"{}", 2);
+        TEMPLATE_RAW("{}");
     } else {
-        tx_json_append((uint8_t *)"{\"ks\":{\"pred\":\"keys-all\",\"keys\":[\"", 34);
-        tx_json_append((uint8_t *)chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
-        tx_json_append((uint8_t *)"\"]}}", 4);
+        TEMPLATE_RAW("{\"ks\":{\"pred\":\"keys-all\",\"keys\":[\"");
+        parser_templateRaw(chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
+        TEMPLATE_RAW("\"]}}");
     }
 
-    tx_json_append((uint8_t *)",\"code\":\"(", 10);
-    tx_json_append((uint8_t *)namespace_and_module, strlen(namespace_and_module));
+    TEMPLATE_RAW(",\"code\":\"(");
+    parser_templateRaw(namespace_and_module, module_len);
 
     switch (tx_type) {
         case TX_TYPE_TRANSFER:
-            tx_json_append((uint8_t *)".transfer", 9);
+            TEMPLATE_RAW(".transfer");
             break;
         case TX_TYPE_TRANSFER_CREATE:
-            tx_json_append((uint8_t *)".transfer-create", 16);
+            TEMPLATE_RAW(".transfer-create");
             break;
         case TX_TYPE_TRANSFER_CROSSCHAIN:
-            tx_json_append((uint8_t *)".transfer-crosschain", 20);
+            TEMPLATE_RAW(".transfer-crosschain");
             break;
     }
 
-    tx_json_append((uint8_t *)" \\\"k:", 5);
-    tx_json_append((uint8_t *)address, address_len);
-    tx_json_append((uint8_t *)"\\\" \\\"k:", 7);
-    tx_json_append((uint8_t *)chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
-    tx_json_append((uint8_t *)"\\\"", 2);
+    TEMPLATE_RAW(" \\\"k:");
+    parser_templateRaw(address, address_len);
+    TEMPLATE_RAW("\\\" \\\"k:");
+    parser_templateRaw(chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
+    TEMPLATE_RAW("\\\"");
 
     if (tx_type != TX_TYPE_TRANSFER) {
-        tx_json_append((uint8_t *)" (read-keyset \\\"ks\\\")", 21);
+        TEMPLATE_RAW(" (read-keyset \\\"ks\\\")");
     }
 
     if (tx_type == TX_TYPE_TRANSFER_CROSSCHAIN) {
-        tx_json_append((uint8_t *)" \\\"", 3);
-        tx_json_append((uint8_t *)chunks[RECIPIENT_CHAIN_POS].data, chunks[RECIPIENT_CHAIN_POS].len);
-        tx_json_append((uint8_t *)"\\\"", 2);
-    }
-
-    tx_json_append((uint8_t *)" ", 1);
-    tx_json_append((uint8_t *)chunks[AMOUNT_POS].data, chunks[AMOUNT_POS].len);
-    tx_json_append((uint8_t *)")\"}},\"signers\":[{\"pubKey\":\"", 27);
-    tx_json_append((uint8_t *)address, address_len);
-    tx_json_append((uint8_t *)"\",\"clist\":[{\"args\":[\"k:", 23);
-    tx_json_append((uint8_t *)address, address_len);
-    tx_json_append((uint8_t *)"\",\"k:", 5);
-    tx_json_append((uint8_t *)chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
-    tx_json_append((uint8_t *)"\",", 2);
-    tx_json_append((uint8_t *)chunks[AMOUNT_POS].data, chunks[AMOUNT_POS].len);
+        TEMPLATE_RAW(" \\\"");
+        parser_templateRaw(chunks[RECIPIENT_CHAIN_POS].data, chunks[RECIPIENT_CHAIN_POS].len);
+        TEMPLATE_RAW("\\\"");
+    }
+
+    TEMPLATE_RAW(" ");
+    parser_templateRaw(chunks[AMOUNT_POS].data, chunks[AMOUNT_POS].len);
+    TEMPLATE_RAW(")\"}");
+    parser_templateClose(w, JSMN_OBJECT);
+    TEMPLATE_RAW(",");
+
+    parser_templateKey(w, &json_key_signers);
+    parser_templateOpen(w, JSMN_ARRAY);
+    parser_templateOpen(w, JSMN_OBJECT);
+    parser_templateKey(w, &json_key_pubkey);
+    parser_templateString(w, address, address_len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_clist);
+    parser_templateOpen(w, JSMN_ARRAY);
+
+    // Transfer capability
+    parser_templateOpen(w, JSMN_OBJECT);
+    parser_templateKey(w, &json_key_args);
+    parser_templateOpen(w, JSMN_ARRAY);
+    uint16_t start = parser_templateStringBegin();
+    TEMPLATE_RAW("k:");
+    parser_templateRaw(address, address_len);
+    parser_templateStringEnd(w, start);
+    TEMPLATE_RAW(",");
+    start = parser_templateStringBegin();
+    TEMPLATE_RAW("k:");
+    parser_templateRaw(chunks[RECIPIENT_POS].data, chunks[RECIPIENT_POS].len);
+    parser_templateStringEnd(w, start);
+    TEMPLATE_RAW(",");
+    parser_templatePrimitive(w, chunks[AMOUNT_POS].data, chunks[AMOUNT_POS].len);
 
     if (tx_type == TX_TYPE_TRANSFER_CROSSCHAIN) {
-        tx_json_append((uint8_t *)",\"", 2);
-        tx_json_append((uint8_t *)chunks[RECIPIENT_CHAIN_POS].data, chunks[RECIPIENT_CHAIN_POS].len);
-        tx_json_append((uint8_t *)"\"", 1);
+        TEMPLATE_RAW(",");
+        parser_templateString(w, chunks[RECIPIENT_CHAIN_POS].data, chunks[RECIPIENT_CHAIN_POS].len);
     }
 
-    tx_json_append((uint8_t *)"],\"name\":\"", 10);
-    tx_json_append((uint8_t *)namespace_and_module, strlen(namespace_and_module));
-    tx_json_append((uint8_t *)".TRANSFER", 9);
+    parser_templateClose(w, JSMN_ARRAY);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_name);
+    start = parser_templateStringBegin();
+    parser_templateRaw(namespace_and_module, module_len);
+    TEMPLATE_RAW(".TRANSFER");
 
     if (tx_type == TX_TYPE_TRANSFER_CROSSCHAIN) {
-        tx_json_append((uint8_t *)"_XCHAIN", 7);
-    }
-
-    tx_json_append((uint8_t *)"\"},{\"args\":[],\"name\":\"coin.GAS\"}]}],\"meta\":{\"creationTime\":", 59);
-    tx_json_append((uint8_t *)chunks[CREATION_TIME_POS].data, chunks[CREATION_TIME_POS].len);
-    tx_json_append((uint8_t *)",\"ttl\":", 7);
-    tx_json_append((uint8_t *)chunks[TTL_POS].data, chunks[TTL_POS].len);
-    tx_json_append((uint8_t *)",\"gasLimit\":", 12);
-    tx_json_append((uint8_t *)chunks[GAS_LIMIT_POS].data, chunks[GAS_LIMIT_POS].len);
-    tx_json_append((uint8_t *)",\"chainId\":\"", 12);
-    tx_json_append((uint8_t *)chunks[CHAIN_ID_POS].data, chunks[CHAIN_ID_POS].len);
-    tx_json_append((uint8_t *)"\",\"gasPrice\":", 13);
-    tx_json_append((uint8_t *)chunks[GAS_PRICE_POS].data, chunks[GAS_PRICE_POS].len);
-    tx_json_append((uint8_t *)",\"sender\":\"k:", 13);
-    tx_json_append((uint8_t *)address, address_len);
-    tx_json_append((uint8_t *)"\"},\"nonce\":\"", 12);
-    tx_json_append((uint8_t *)chunks[NONCE_POS].data, chunks[NONCE_POS].len);
-    tx_json_append((uint8_t *)"\"}", 2);
+        TEMPLATE_RAW("_XCHAIN");
+    }
+
+    parser_templateStringEnd(w, start);
+    parser_templateClose(w, JSMN_OBJECT);
+    TEMPLATE_RAW(",");
+
+    // Gas capability
+    parser_templateOpen(w, JSMN_OBJECT);
+    parser_templateKey(w, &json_key_args);
+    parser_templateOpen(w, JSMN_ARRAY);
+    parser_templateClose(w, JSMN_ARRAY);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_name);
+    parser_templateString(w, "coin.GAS", sizeof("coin.GAS") - 1);
+    parser_templateClose(w, JSMN_OBJECT);
+
+    parser_templateClose(w, JSMN_ARRAY);
+    parser_templateClose(w, JSMN_OBJECT);
+    parser_templateClose(w, JSMN_ARRAY);
+    TEMPLATE_RAW(",");
+
+    parser_templateKey(w, &json_key_meta);
+    parser_templateOpen(w, JSMN_OBJECT);
+    parser_templateKey(w, &json_key_creation_time);
+    parser_templatePrimitive(w, chunks[CREATION_TIME_POS].data, chunks[CREATION_TIME_POS].len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_ttl);
+    parser_templatePrimitive(w, chunks[TTL_POS].data, chunks[TTL_POS].len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_gas_limit);
+    parser_templatePrimitive(w, chunks[GAS_LIMIT_POS].data, chunks[GAS_LIMIT_POS].len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_chain_id);
+    parser_templateString(w, chunks[CHAIN_ID_POS].data, chunks[CHAIN_ID_POS].len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_gas_price);
+    parser_templatePrimitive(w, chunks[GAS_PRICE_POS].data, chunks[GAS_PRICE_POS].len);
+    TEMPLATE_RAW(",");
+    parser_templateKey(w, &json_key_sender);
+    start = parser_templateStringBegin();
+    TEMPLATE_RAW("k:");
+    parser_templateRaw(address, address_len);
+    parser_templateStringEnd(w, start);
+    parser_templateClose(w, JSMN_OBJECT);
+    TEMPLATE_RAW(",");
+
+    parser_templateKey(w, &json_key_nonce);
+    parser_templateString(w, chunks[NONCE_POS].data, chunks[NONCE_POS].len);
+    parser_templateClose(w, JSMN_OBJECT);
 
     return parser_ok;
 }
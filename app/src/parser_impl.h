@@ -30,6 +30,8 @@ extern "C" {
 #define TX_TYPE_TRANSFER_CROSSCHAIN 2
 
 #define JSON_NETWORK_ID "networkId"
+#define JSON_PAYLOAD "payload"
+#define JSON_NONCE "nonce"
 #define JSON_META "meta"
 #define JSON_SIGNERS "signers"
 #define JSON_PUBKEY "pubKey"
@@ -42,6 +44,32 @@ extern "C" {
 #define JSON_GAS_LIMIT "gasLimit"
 #define JSON_GAS_PRICE "gasPrice"
 #define JSON_SENDER "sender"
+#define JSON_DECIMAL "decimal"
+
+// Largest transfer amounts that can be added up exactly, see parser_getTransferAmount
+#define TRANSFER_AMOUNT_MAX_INT_DIGITS 20
+#define TRANSFER_AMOUNT_MAX_FRAC_DIGITS 24
+
+// Key descriptors for the literals above, see JSON_KEY
+extern const json_key_t json_key_network_id;
+extern const json_key_t json_key_payload;
+extern const json_key_t json_key_nonce;
+extern const json_key_t json_key_meta;
+extern const json_key_t json_key_signers;
+extern const json_key_t json_key_pubkey;
+extern const json_key_t json_key_clist;
+extern const json_key_t json_key_args;
+extern const json_key_t json_key_name;
+extern const json_key_t json_key_creation_time;
+extern const json_key_t json_key_ttl;
+extern const json_key_t json_key_chain_id;
+extern const json_key_t json_key_gas_limit;
+extern const json_key_t json_key_gas_price;
+extern const json_key_t json_key_sender;
+extern const json_key_t json_key_decimal;
+
+// Top-level keys whose values are not tokenized
+extern const json_opaque_keys_t cmd_opaque_keys;
 
 typedef struct {
     const uint8_t *buffer;
@@ -60,17 +88,21 @@ typedef struct {
 } chunk_t;
 
 parser_error_t _read_json_tx(parser_context_t *c);
+parser_error_t _read_json_template_tx(parser_context_t *c);
 parser_error_t _read_hash_tx(parser_context_t *c);
 tx_json_t *parser_getParserJsonObj();
+const kadena_cmd_index_t *parser_getCmdIndex();
 tx_hash_t *parser_getParserHashObj();
-parser_error_t parser_findPubKeyInClist(uint16_t key_token_index);
+parser_error_t parser_isSignerScoped(uint8_t signer_index);
 parser_error_t parser_arrayElementToString(uint16_t json_token_index, uint16_t element_idx, const char **outVal,
                                            uint8_t *outValLen);
 parser_error_t parser_validateMetaField();
 parser_error_t parser_getTxName(uint16_t token_index);
+parser_error_t parser_getTxModule(uint16_t token_index, const char **module, uint16_t *module_len);
+parser_error_t parser_getTransferAmount(uint16_t token_index, const char **amount, uint16_t *amount_len);
+bool parser_isSameTransferGroup(uint16_t token_index_a, uint16_t token_index_b);
 parser_error_t parser_getValidClist(uint16_t *clist_token_index, uint16_t *num_args);
 bool items_isNullField(uint16_t json_token_index);
-parser_error_t parser_createJsonTemplate(parser_context_t *ctx);
 
 #ifdef __cplusplus
 }
@@ -27,6 +27,74 @@ extern "C" {
 
 typedef enum tx_type_t { tx_type_json, tx_type_hash, tx_type_transfer } tx_type_t;
 
+#define MAX_NUMBER_OF_SIGNERS 8
+
+#if defined(TARGET_NANOS)
+#define MAX_NUMBER_OF_CLIST_KEYS 16
+#else
+#define MAX_NUMBER_OF_CLIST_KEYS 32
+#endif
+
+// Length of a public key in hex, as used in signers[] and in capability args
+#define KEY_HEX_LEN 64
+
+// Fields of a Kadena command that the app reads, either at the top level or inside "meta"
+typedef enum {
+    cmd_field_network_id,
+    cmd_field_payload,
+    cmd_field_signers,
+    cmd_field_meta,
+    cmd_field_nonce,
+    cmd_field_creation_time,
+    cmd_field_ttl,
+    cmd_field_gas_limit,
+    cmd_field_chain_id,
+    cmd_field_gas_price,
+    cmd_field_sender,
+    cmd_field_count,
+} cmd_field_t;
+
+#define CMD_FIELD_BIT(__field) ((uint16_t)(1u << (__field)))
+#define CMD_HAS_FIELD(__cmd, __field) (((__cmd)->present & CMD_FIELD_BIT(__field)) != 0)
+#define CMD_IS_NULL(__cmd, __field) (((__cmd)->null & CMD_FIELD_BIT(__field)) != 0)
+
+// Fields that a recognized meta object holds exactly once each, in any order
+#define CMD_META_FIELDS                                                                                           \
+    (CMD_FIELD_BIT(cmd_field_creation_time) | CMD_FIELD_BIT(cmd_field_ttl) | CMD_FIELD_BIT(cmd_field_gas_limit) | \
+     CMD_FIELD_BIT(cmd_field_chain_id) | CMD_FIELD_BIT(cmd_field_gas_price) | CMD_FIELD_BIT(cmd_field_sender))
+
+#define SIGNER_PUBKEY_BIT 0x01
+#define SIGNER_CLIST_BIT 0x02
+
+typedef struct {
+    uint16_t pubKey;
+    uint16_t clist;
+    uint8_t present;  // SIGNER_*_BIT
+    uint8_t null;     // SIGNER_*_BIT
+} cmd_signer_t;
+
+// Capability arg that holds a public key, either as KEY_HEX_LEN hex characters or prefixed by "k:"
+typedef struct {
+    uint32_t digest;  // parser_keyDigest of the hex characters
+    uint16_t token;   // token index of the arg
+    uint8_t signer;   // index in signers[] of the clist the arg belongs to
+} cmd_clist_key_t;
+
+// Token indices of every field the app needs, filled in a single walk right after tokenization
+typedef struct {
+    uint16_t token[cmd_field_count];  // value token of each field, 0 when missing
+    uint16_t present;                 // CMD_FIELD_BIT of every field found
+    uint16_t null;                    // CMD_FIELD_BIT of every field whose value is null
+    uint16_t numberOfSigners;         // number of entries in "signers", may exceed MAX_NUMBER_OF_SIGNERS
+    bool metaUnexpected;              // meta holds a key that is not in CMD_META_FIELDS, or one of them twice
+    cmd_signer_t signers[MAX_NUMBER_OF_SIGNERS];
+    uint8_t deviceSigner;       // entry of signers[] whose pubKey is the device key, 0 when none matches
+    bool deviceSignerUnknown;   // there are several signers and none of signers[] is the device key
+    uint8_t numberOfClistKeys;  // entries used in clistKeys
+    bool clistKeysOverflow;     // some keys did not fit in clistKeys, lookups must fall back to walking the clists
+    cmd_clist_key_t clistKeys[MAX_NUMBER_OF_CLIST_KEYS];
+} kadena_cmd_index_t;
+
 typedef struct {
     // Buffer to the original tx blob
     const char *tx;
@@ -34,6 +102,9 @@ typedef struct {
     // parsed data (tokens, etc.)
     parsed_json_t json;
 
+    // location of the command fields within the parsed tokens
+    kadena_cmd_index_t cmd;
+
     // internal flags
     struct {
         bool cache_valid : 1;
@@ -23,6 +23,7 @@
 #include "parser.h"
 #include "parser_impl.h"
 #include "parser_txdef.h"
+#include "tx.h"
 #include "utils/common.h"
 
 namespace {
@@ -40,7 +41,7 @@ TEST(JsonParserTest, SinglePrimitive) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(1, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_PRIMITIVE);
 }
 
 TEST(JsonParserTest, KeyValuePrimitives) {
@@ -49,8 +50,8 @@ TEST(JsonParserTest, KeyValuePrimitives) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(2, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[1].type == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[1]) == jsmntype_t::JSMN_PRIMITIVE);
 }
 
 TEST(JsonParserTest, SingleString) {
@@ -59,7 +60,7 @@ TEST(JsonParserTest, SingleString) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(1, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_STRING);
 }
 
 TEST(JsonParserTest, KeyValueStrings) {
@@ -68,8 +69,8 @@ TEST(JsonParserTest, KeyValueStrings) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(2, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[1].type == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[1]) == jsmntype_t::JSMN_STRING);
 }
 
 TEST(JsonParserTest, SimpleArray) {
@@ -78,12 +79,12 @@ TEST(JsonParserTest, SimpleArray) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(6, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[1].type == jsmntype_t::JSMN_ARRAY);
-    EXPECT_TRUE(parserData.tokens[2].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[3].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[4].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[5].type == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[1]) == jsmntype_t::JSMN_ARRAY);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[2]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[3]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[4]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[5]) == jsmntype_t::JSMN_PRIMITIVE);
 }
 
 TEST(JsonParserTest, MixedArray) {
@@ -92,12 +93,12 @@ TEST(JsonParserTest, MixedArray) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(6, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[1].type == jsmntype_t::JSMN_ARRAY);
-    EXPECT_TRUE(parserData.tokens[2].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[3].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[4].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[5].type == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[1]) == jsmntype_t::JSMN_ARRAY);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[2]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[3]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[4]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[5]) == jsmntype_t::JSMN_STRING);
 }
 
 TEST(JsonParserTest, SimpleObject) {
@@ -113,16 +114,16 @@ TEST(JsonParserTest, SimpleObject) {
 
     EXPECT_TRUE(parserData.isValid);
     EXPECT_EQ(10, parserData.numberOfTokens);
-    EXPECT_TRUE(parserData.tokens[0].type == jsmntype_t::JSMN_PRIMITIVE);
-    EXPECT_TRUE(parserData.tokens[1].type == jsmntype_t::JSMN_OBJECT);
-    EXPECT_TRUE(parserData.tokens[2].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[3].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[4].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[5].type == jsmntype_t::JSMN_OBJECT);
-    EXPECT_TRUE(parserData.tokens[6].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[7].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[8].type == jsmntype_t::JSMN_STRING);
-    EXPECT_TRUE(parserData.tokens[9].type == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[0]) == jsmntype_t::JSMN_PRIMITIVE);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[1]) == jsmntype_t::JSMN_OBJECT);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[2]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[3]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[4]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[5]) == jsmntype_t::JSMN_OBJECT);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[6]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[7]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[8]) == jsmntype_t::JSMN_STRING);
+    EXPECT_TRUE(JSMN_TOKEN_TYPE(&parserData.tokens[9]) == jsmntype_t::JSMN_PRIMITIVE);
 }
 
 TEST(JsonParserTest, ArrayElementCount_objects) {
@@ -179,7 +180,7 @@ TEST(JsonParserTest, ArrayElementGet_objects) {
     uint16_t token_index;
     EXPECT_EQ(array_get_nth_element(&parsed_json, 2, 1, &token_index), parser_ok);
     EXPECT_EQ(token_index, 8) << "Wrong token index returned";
-    EXPECT_EQ(parsed_json.tokens[token_index].type, JSMN_OBJECT) << "Wrong token type returned";
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_OBJECT) << "Wrong token type returned";
 }
 
 TEST(JsonParserTest, ArrayElementGet_primitives) {
@@ -191,7 +192,7 @@ TEST(JsonParserTest, ArrayElementGet_primitives) {
     uint16_t token_index;
     EXPECT_EQ(array_get_nth_element(&parsed_json, 2, 5, &token_index), parser_ok);
     EXPECT_EQ(token_index, 8) << "Wrong token index returned";
-    EXPECT_EQ(parsed_json.tokens[token_index].type, JSMN_PRIMITIVE) << "Wrong token type returned";
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_PRIMITIVE) << "Wrong token type returned";
 }
 
 TEST(TxValidationTest, ArrayElementGet_strings) {
@@ -203,7 +204,7 @@ TEST(TxValidationTest, ArrayElementGet_strings) {
     uint16_t token_index;
     EXPECT_EQ(array_get_nth_element(&parsed_json, 2, 0, &token_index), parser_ok);
     EXPECT_EQ(token_index, 3) << "Wrong token index returned";
-    EXPECT_EQ(parsed_json.tokens[token_index].type, JSMN_STRING) << "Wrong token type returned";
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_STRING) << "Wrong token type returned";
 }
 
 TEST(TxValidationTest, ArrayElementGet_empty) {
@@ -311,8 +312,9 @@ TEST(TxValidationTest, ObjectElementGet_primitives) {
     uint16_t token_index;
     EXPECT_EQ(object_get_nth_key(&parsed_json, 0, 0, &token_index), parser_ok);
     EXPECT_EQ(token_index, 1) << "Wrong token index";
-    EXPECT_EQ(parsed_json.tokens[token_index].type, JSMN_STRING) << "Wrong token type returned";
-    EXPECT_EQ(memcmp(transaction + parsed_json.tokens[token_index].start, "age", strlen("age")), 0) << "Wrong key returned";
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_STRING) << "Wrong token type returned";
+    EXPECT_EQ(memcmp(transaction + JSMN_TOKEN_START(&parsed_json.tokens[token_index]), "age", strlen("age")), 0)
+        << "Wrong key returned";
 }
 
 TEST(TxValidationTest, ObjectElementGet_string) {
@@ -324,8 +326,8 @@ TEST(TxValidationTest, ObjectElementGet_string) {
     uint16_t token_index;
     EXPECT_EQ(object_get_nth_value(&parsed_json, 0, 3, &token_index), parser_ok);
     EXPECT_EQ(token_index, 8) << "Wrong token index";
-    EXPECT_EQ(parsed_json.tokens[token_index].type, JSMN_STRING) << "Wrong token type returned";
-    EXPECT_EQ(memcmp(transaction + parsed_json.tokens[token_index].start, "july", strlen("july")), 0)
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_STRING) << "Wrong token type returned";
+    EXPECT_EQ(memcmp(transaction + JSMN_TOKEN_START(&parsed_json.tokens[token_index]), "july", strlen("july")), 0)
         << "Wrong key returned";
 }
 
@@ -364,12 +366,561 @@ TEST(TxValidationTest, ObjectElementGet_array) {
     EXPECT_EQ(object_get_value(&parsed_json, 0, "years", &token_index), parser_ok);
 
     EXPECT_EQ(token_index, 14) << "Wrong token index";
-    EXPECT_EQ(parsed_json.tokens[token_index].type, JSMN_ARRAY) << "Wrong token type returned";
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_ARRAY) << "Wrong token type returned";
     uint16_t number_elements;
     EXPECT_EQ(array_get_element_count(&parsed_json, token_index, &number_elements), parser_ok);
     EXPECT_EQ(number_elements, 5) << "Wrong number of array elements";
 }
 
+TEST(JsonParserTest, SkipIndex_nested) {
+    auto transaction = R"({"a":{"b":[1,{"c":2}],"d":3},"e":[],"f":"g"})";
+
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction);
+    ASSERT_TRUE(parsed_json.isValid);
+    ASSERT_EQ(parsed_json.numberOfTokens, 15);
+
+    // Root object spans the whole input
+    EXPECT_EQ(parsed_json.nextSibling[0], 15);
+    // "a" -> {...}: the value skips its whole subtree up to "e"
+    EXPECT_EQ(parsed_json.nextSibling[1], 2);
+    EXPECT_EQ(parsed_json.nextSibling[2], 11);
+    // "b" -> [1, {"c":2}] jumps straight to "d"
+    EXPECT_EQ(parsed_json.nextSibling[4], 9);
+    // Empty array has no children
+    EXPECT_EQ(parsed_json.nextSibling[12], 13);
+    // Last token points past the end
+    EXPECT_EQ(parsed_json.nextSibling[14], 15);
+}
+
+TEST(JsonParserTest, SkipIndex_lookups) {
+    auto transaction = R"({"a":{"b":[1,{"c":2}],"d":3},"e":[[1,2],[3,[4,5]],6],"f":"g"})";
+
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction);
+
+    uint16_t token_index = 0;
+    uint16_t count = 0;
+    EXPECT_EQ(object_get_element_count(&parsed_json, 0, &count), parser_ok);
+    EXPECT_EQ(count, 3);
+
+    EXPECT_EQ(object_get_value(&parsed_json, 0, "f", &token_index), parser_ok);
+    EXPECT_EQ(memcmp(transaction + JSMN_TOKEN_START(&parsed_json.tokens[token_index]), "g", 1), 0);
+
+    EXPECT_EQ(object_get_value(&parsed_json, 0, "e", &token_index), parser_ok);
+    const uint16_t array_index = token_index;
+    EXPECT_EQ(array_get_element_count(&parsed_json, array_index, &count), parser_ok);
+    EXPECT_EQ(count, 3);
+
+    EXPECT_EQ(array_get_nth_element(&parsed_json, array_index, 2, &token_index), parser_ok);
+    EXPECT_EQ(memcmp(transaction + JSMN_TOKEN_START(&parsed_json.tokens[token_index]), "6", 1), 0);
+    EXPECT_EQ(array_get_nth_element(&parsed_json, array_index, 3, &token_index), parser_no_data);
+
+    EXPECT_EQ(object_get_value(&parsed_json, 0, "c", &token_index), parser_no_data)
+        << "Nested keys must not be found at the top level";
+}
+
+TEST(JsonParserTest, ArrayIterator) {
+    auto transaction = R"({"array":[{"amount":5,"denom":"photon"}, [1, [2, 3]], "text", 7]})";
+
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction);
+
+    json_iter_t iter;
+    uint16_t token_index = 0;
+    std::vector<uint16_t> elements;
+    ASSERT_EQ(json_array_iter_begin(&parsed_json, 2, &iter), parser_ok);
+    while (json_array_iter_next(&parsed_json, &iter, &token_index) == parser_ok) {
+        elements.push_back(token_index);
+    }
+
+    ASSERT_EQ(elements.size(), 4);
+    for (uint16_t i = 0; i < elements.size(); i++) {
+        uint16_t nth_index = 0;
+        EXPECT_EQ(array_get_nth_element(&parsed_json, 2, i, &nth_index), parser_ok);
+        EXPECT_EQ(elements[i], nth_index) << "Iterator and nth lookup disagree at element " << i;
+    }
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[elements[1]]), JSMN_ARRAY);
+    EXPECT_EQ(json_array_iter_next(&parsed_json, &iter, &token_index), parser_no_data);
+}
+
+TEST(JsonParserTest, ObjectIterator) {
+    auto transaction = R"({"age":36, "nested":{"a":[1,2,3],"b":{}}, "year":1981})";
+
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction);
+
+    json_iter_t iter;
+    uint16_t key_index = 0;
+    uint16_t value_index = 0;
+    std::vector<std::string> keys;
+    ASSERT_EQ(json_object_iter_begin(&parsed_json, 0, &iter), parser_ok);
+    while (json_object_iter_next(&parsed_json, &iter, &key_index, &value_index) == parser_ok) {
+        const jsmntok_t &key = parsed_json.tokens[key_index];
+        keys.emplace_back(transaction + JSMN_TOKEN_START(&key), JSMN_TOKEN_LEN(&key));
+
+        uint16_t expected_value = 0;
+        EXPECT_EQ(object_get_value(&parsed_json, 0, keys.back().c_str(), &expected_value), parser_ok);
+        EXPECT_EQ(value_index, expected_value);
+    }
+
+    EXPECT_THAT(keys, testing::ElementsAre("age", "nested", "year"));
+    EXPECT_EQ(json_object_iter_begin(&parsed_json, parsed_json.numberOfTokens, &iter), parser_no_data);
+}
+
+TEST(JsonParserTest, KeyDescriptorHashes) {
+    const json_key_t *keys[] = {&json_key_network_id, &json_key_payload,       &json_key_nonce,   &json_key_meta,
+                                &json_key_signers,    &json_key_pubkey,        &json_key_clist,   &json_key_args,
+                                &json_key_name,       &json_key_creation_time, &json_key_ttl,     &json_key_chain_id,
+                                &json_key_gas_limit,  &json_key_gas_price,     &json_key_sender,  &json_key_decimal};
+
+    for (const json_key_t *key : keys) {
+        EXPECT_EQ(key->len, strlen(key->str)) << key->str;
+        EXPECT_EQ(key->hash, json_key_hash(key->str, key->len)) << key->str;
+    }
+}
+
+TEST(JsonParserTest, OnlyKeysAreHashed) {
+    auto transaction = R"({"clist":"clist","args":["clist",{"clist":1}]})";
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction);
+
+    // Keys at any depth are hashed, string values and array elements are not
+    EXPECT_EQ(parsed_json.keyHash[1], json_key_clist.hash);
+    EXPECT_EQ(parsed_json.keyHash[2], 0);
+    EXPECT_EQ(parsed_json.keyHash[3], json_key_args.hash);
+    EXPECT_EQ(parsed_json.keyHash[5], 0);
+    EXPECT_EQ(parsed_json.keyHash[7], json_key_clist.hash);
+    EXPECT_EQ(parsed_json.keyHash[8], 0);
+
+    EXPECT_TRUE(json_token_equals_key(&parsed_json, 7, &json_key_clist));
+    EXPECT_TRUE(json_key_matches(&json_key_clist, "clist", 5, json_key_hash("clist", 5)));
+    EXPECT_FALSE(json_key_matches(&json_key_clist, "clis", 4, json_key_hash("clis", 4)));
+}
+
+TEST(JsonParserTest, ObjectGetValueByKey) {
+    auto transaction = R"({"clis":1,"clistx":2,"clist":[3],"args":4})";
+
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction);
+
+    uint16_t token_index = 0;
+    EXPECT_EQ(object_get_value_by_key(&parsed_json, 0, &json_key_clist, &token_index), parser_ok);
+    EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[token_index]), JSMN_ARRAY);
+    EXPECT_EQ(object_get_value_by_key(&parsed_json, 0, &json_key_args, &token_index), parser_ok);
+    EXPECT_EQ(memcmp(transaction + JSMN_TOKEN_START(&parsed_json.tokens[token_index]), "4", 1), 0);
+    EXPECT_EQ(object_get_value_by_key(&parsed_json, 0, &json_key_meta, &token_index), parser_no_data);
+
+    EXPECT_TRUE(json_token_equals_key(&parsed_json, 5, &json_key_clist));
+    EXPECT_FALSE(json_token_equals_key(&parsed_json, 1, &json_key_clist));
+    EXPECT_FALSE(json_token_equals_key(&parsed_json, 3, &json_key_clist));
+}
+
+TEST(JsonParserTest, StreamMatchesFullParse) {
+    const std::string transaction =
+        R"json({"networkId":"mainnet01","payload":{"exec":{"data":{"k":[1,true,null,-2.5e3]},"code":"(coin.transfer \"a\u0041\" 11.0)"}},"nonce":12345})json";
+
+    parsed_json_t expected;
+    JSON_PARSE(&expected, transaction.c_str());
+
+    for (size_t chunk = 1; chunk <= transaction.size(); chunk++) {
+        parsed_json_t streamed;
+        json_parse_stream_init(&streamed, NULL);
+        for (size_t received = chunk; received < transaction.size(); received += chunk) {
+            ASSERT_EQ(json_parse_stream_append(&streamed, transaction.c_str(), received), parser_ok) << chunk;
+        }
+        ASSERT_EQ(json_parse_stream_finish(&streamed, transaction.c_str(), transaction.size(), NULL), parser_ok) << chunk;
+
+        ASSERT_EQ(streamed.numberOfTokens, expected.numberOfTokens) << chunk;
+        for (uint32_t i = 0; i < expected.numberOfTokens; i++) {
+            EXPECT_EQ(JSMN_TOKEN_TYPE(&streamed.tokens[i]), JSMN_TOKEN_TYPE(&expected.tokens[i])) << chunk << " " << i;
+            EXPECT_EQ(JSMN_TOKEN_START(&streamed.tokens[i]), JSMN_TOKEN_START(&expected.tokens[i])) << chunk << " " << i;
+            EXPECT_EQ(JSMN_TOKEN_END(&streamed.tokens[i]), JSMN_TOKEN_END(&expected.tokens[i])) << chunk << " " << i;
+            EXPECT_EQ(streamed.nextSibling[i], expected.nextSibling[i]) << chunk << " " << i;
+        }
+    }
+}
+
+TEST(JsonParserTest, StreamErrorFallsBackToFullParse) {
+    const std::string transaction = R"({"a":[1,2}})";
+
+    parsed_json_t streamed;
+    json_parse_stream_init(&streamed, NULL);
+    EXPECT_EQ(json_parse_stream_append(&streamed, transaction.c_str(), transaction.size()), parser_unexpected_characters);
+    EXPECT_FALSE(streamed.isStreaming);
+    EXPECT_EQ(json_parse_stream_finish(&streamed, transaction.c_str(), transaction.size(), NULL),
+              parser_unexpected_characters);
+
+    const std::string primitive = "EMPTY";
+    json_parse_stream_init(&streamed, NULL);
+    EXPECT_EQ(json_parse_stream_append(&streamed, primitive.c_str(), 3), parser_ok);
+    EXPECT_EQ(json_parse_stream_finish(&streamed, primitive.c_str(), primitive.size(), NULL), parser_ok);
+    EXPECT_EQ(streamed.numberOfTokens, 1);
+    EXPECT_EQ(JSMN_TOKEN_END(&streamed.tokens[0]), primitive.size());
+}
+
+TEST(JsonParserTest, StreamDepthLimit) {
+    const std::string deepest = std::string(MAX_JSON_DEPTH, '[') + std::string(MAX_JSON_DEPTH, ']');
+    const std::string too_deep = "[" + deepest + "]";
+    parsed_json_t expected;
+    ASSERT_EQ(json_parse(&expected, too_deep.c_str(), too_deep.size()), parser_value_out_of_range);
+
+    parsed_json_t streamed;
+    for (size_t chunk : {(size_t)1, (size_t)7, too_deep.size()}) {
+        json_parse_stream_init(&streamed, NULL);
+        parser_error_t err = parser_ok;
+        for (size_t received = chunk; received < too_deep.size() && err == parser_ok; received += chunk) {
+            err = json_parse_stream_append(&streamed, too_deep.c_str(), received);
+        }
+        EXPECT_EQ(json_parse_stream_finish(&streamed, too_deep.c_str(), too_deep.size(), NULL), parser_value_out_of_range)
+            << chunk;
+        EXPECT_FALSE(streamed.isValid) << chunk;
+    }
+
+    json_parse_stream_init(&streamed, NULL);
+    ASSERT_EQ(json_parse_stream_append(&streamed, deepest.c_str(), deepest.size() - 1), parser_ok);
+    EXPECT_EQ(json_parse_stream_finish(&streamed, deepest.c_str(), deepest.size(), NULL), parser_ok);
+}
+
+TEST(JsonParserTest, PackedTokens) {
+    EXPECT_EQ(sizeof(jsmntok_t), 4u);
+
+    const std::string transaction = R"({"a":[1,"b"],"c":{}})";
+    parsed_json_t parsed_json;
+    JSON_PARSE(&parsed_json, transaction.c_str());
+
+    const jsmntype_t types[] = {JSMN_OBJECT, JSMN_STRING, JSMN_ARRAY, JSMN_PRIMITIVE, JSMN_STRING, JSMN_STRING, JSMN_OBJECT};
+    const uint16_t starts[] = {0, 2, 5, 6, 9, 14, 17};
+    const uint16_t ends[] = {20, 3, 12, 7, 10, 15, 19};
+    ASSERT_EQ(parsed_json.numberOfTokens, 7u);
+    for (uint32_t i = 0; i < parsed_json.numberOfTokens; i++) {
+        EXPECT_EQ(JSMN_TOKEN_TYPE(&parsed_json.tokens[i]), types[i]) << i;
+        EXPECT_EQ(JSMN_TOKEN_START(&parsed_json.tokens[i]), starts[i]) << i;
+        EXPECT_EQ(JSMN_TOKEN_END(&parsed_json.tokens[i]), ends[i]) << i;
+    }
+
+    // The longest input still fits, anything longer is rejected
+    const std::string longest = "[\"" + std::string(JSMN_MAX_LENGTH - 4, 'a') + "\"]";
+    ASSERT_EQ(json_parse(&parsed_json, longest.c_str(), longest.size()), parser_ok);
+    EXPECT_EQ(JSMN_TOKEN_END(&parsed_json.tokens[0]), JSMN_MAX_LENGTH);
+    EXPECT_EQ(JSMN_TOKEN_START(&parsed_json.tokens[1]), 2);
+    const std::string large = "\"" + std::string(JSMN_MAX_OFFSET, 'a') + "\"";
+    EXPECT_EQ(json_parse(&parsed_json, large.c_str(), large.size()), parser_value_out_of_range);
+}
+
+TEST(JsonParserTest, CountingPassLimits) {
+    parsed_json_t parsed_json;
+
+    // MAX_NUMBER_OF_TOKENS elements plus the array itself
+    std::string too_many = "[";
+    for (int i = 0; i < MAX_NUMBER_OF_TOKENS; i++) {
+        too_many += (i == 0) ? "\"x\"" : ",1";
+    }
+    too_many += "]";
+    EXPECT_EQ(json_parse(&parsed_json, too_many.c_str(), too_many.size()), parser_json_too_many_tokens);
+    EXPECT_FALSE(parsed_json.isValid);
+
+    // Exactly at the limit
+    const std::string at_limit = too_many.substr(0, too_many.size() - 3) + "]";
+    EXPECT_EQ(json_parse(&parsed_json, at_limit.c_str(), at_limit.size()), parser_ok);
+    EXPECT_EQ(parsed_json.numberOfTokens, MAX_NUMBER_OF_TOKENS);
+
+    const std::string deepest = std::string(MAX_JSON_DEPTH, '[') + std::string(MAX_JSON_DEPTH, ']');
+    EXPECT_EQ(json_parse(&parsed_json, deepest.c_str(), deepest.size()), parser_ok);
+
+    const std::string too_deep = "[" + deepest + "]";
+    EXPECT_EQ(json_parse(&parsed_json, too_deep.c_str(), too_deep.size()), parser_value_out_of_range);
+}
+
+TEST(JsonParserTest, ScannerWordBoundaries) {
+    // Escapes and delimiters at every offset around the word and vector sizes used by the scanners
+    for (size_t len = 0; len < 40; len++) {
+        for (size_t escape = 0; escape <= len; escape++) {
+            std::string value(len, 'a');
+            if (escape < len) {
+                value.replace(escape, 1, "\\\"");
+            }
+            const std::string number(len + 1, '7');
+            const std::string transaction = R"({"k":")" + value + R"(","n":)" + number + "}";
+
+            parsed_json_t parsed_json;
+            ASSERT_EQ(json_parse(&parsed_json, transaction.c_str(), transaction.size()), parser_ok) << transaction;
+            ASSERT_EQ(parsed_json.numberOfTokens, 5u) << transaction;
+
+            const jsmntok_t *string_token = &parsed_json.tokens[2];
+            EXPECT_EQ(JSMN_TOKEN_START(string_token), 6u);
+            EXPECT_EQ(JSMN_TOKEN_LEN(string_token), value.size()) << transaction;
+
+            const jsmntok_t *number_token = &parsed_json.tokens[4];
+            EXPECT_EQ(JSMN_TOKEN_TYPE(number_token), JSMN_PRIMITIVE);
+            EXPECT_EQ(JSMN_TOKEN_LEN(number_token), number.size()) << transaction;
+            EXPECT_EQ(JSMN_TOKEN_END(number_token), transaction.size() - 1) << transaction;
+        }
+    }
+
+    // Bytes a primitive cannot contain are still rejected after a bulk skip
+    const std::string invalid = "[12345678901234567890\x01]";
+    parsed_json_t parsed_json;
+    EXPECT_EQ(json_parse(&parsed_json, invalid.c_str(), invalid.size()), parser_unexpected_characters);
+}
+
+TEST(JsonParserTest, OpaquePayload) {
+    const std::string transaction =
+        R"json({"networkId":"mainnet01","payload":{"exec":{"data":{"ks":{"keys":["a","b"],"pred":"keys-all"}},"code":"(x \"}\")"}},"nonce":"1"})json";
+
+    const json_parse_config_t config = {&cmd_opaque_keys, NULL, 0};
+    parsed_json_t parsed_json;
+    ASSERT_EQ(json_parse_with_config(&parsed_json, transaction.c_str(), transaction.size(), &config), parser_ok);
+    ASSERT_EQ(parsed_json.numberOfTokens, 7u);
+
+    uint16_t token_index = 0;
+    ASSERT_EQ(object_get_value_by_key(&parsed_json, 0, &json_key_payload, &token_index), parser_ok);
+    const jsmntok_t *payload = &parsed_json.tokens[token_index];
+    EXPECT_EQ(JSMN_TOKEN_TYPE(payload), JSMN_OBJECT);
+    EXPECT_EQ(transaction.substr(JSMN_TOKEN_START(payload), JSMN_TOKEN_LEN(payload)),
+              R"json({"exec":{"data":{"ks":{"keys":["a","b"],"pred":"keys-all"}},"code":"(x \"}\")"}})json");
+    EXPECT_EQ(object_get_value_by_key(&parsed_json, 0, &json_key_nonce, &token_index), parser_ok);
+
+    // Streaming gives the same tokens whatever the chunk size
+    for (size_t chunk = 1; chunk <= transaction.size(); chunk++) {
+        parsed_json_t streamed;
+        json_parse_stream_init(&streamed, &cmd_opaque_keys);
+        for (size_t received = chunk; received < transaction.size(); received += chunk) {
+            ASSERT_EQ(json_parse_stream_append(&streamed, transaction.c_str(), received), parser_ok) << chunk;
+        }
+        ASSERT_EQ(json_parse_stream_finish(&streamed, transaction.c_str(), transaction.size(), &config), parser_ok)
+            << chunk;
+        ASSERT_EQ(streamed.numberOfTokens, parsed_json.numberOfTokens) << chunk;
+        for (uint32_t i = 0; i < parsed_json.numberOfTokens; i++) {
+            EXPECT_EQ(streamed.tokens[i].start_type, parsed_json.tokens[i].start_type) << chunk << " " << i;
+            EXPECT_EQ(streamed.tokens[i].end, parsed_json.tokens[i].end) << chunk << " " << i;
+        }
+    }
+
+    // Nested keys with the same name are tokenized normally
+    const std::string nested = R"({"a":{"payload":[1,2]}})";
+    ASSERT_EQ(json_parse_with_config(&parsed_json, nested.c_str(), nested.size(), &config), parser_ok);
+    EXPECT_EQ(parsed_json.numberOfTokens, 7u);
+
+    // The structure of the skipped value is still checked
+    const std::string mismatched = R"({"payload":{"a":[1,2}},"nonce":"1"})";
+    EXPECT_EQ(json_parse_with_config(&parsed_json, mismatched.c_str(), mismatched.size(), &config),
+              parser_unexpected_characters);
+    const std::string unterminated = R"({"payload":{"a":"1}})";
+    EXPECT_EQ(json_parse_with_config(&parsed_json, unterminated.c_str(), unterminated.size(), &config),
+              parser_json_incomplete_json);
+}
+
+TEST(JsonParserTest, OpaquePayloadDoesNotUseTokenBudget) {
+    std::string transaction = R"({"payload":[)";
+    for (int i = 0; i < MAX_NUMBER_OF_TOKENS; i++) {
+        transaction += (i == 0) ? "1" : ",1";
+    }
+    transaction += R"(],"nonce":"1"})";
+
+    const json_parse_config_t config = {&cmd_opaque_keys, NULL, 0};
+    parsed_json_t parsed_json;
+    EXPECT_EQ(json_parse(&parsed_json, transaction.c_str(), transaction.size()), parser_json_too_many_tokens);
+    EXPECT_EQ(json_parse_with_config(&parsed_json, transaction.c_str(), transaction.size(), &config), parser_ok);
+    EXPECT_EQ(parsed_json.numberOfTokens, 5u);
+}
+
+TEST(JsonParserTest, SpillTokens) {
+    const int elements = 2 * MAX_NUMBER_OF_TOKENS;
+    std::string transaction = R"({"list":[)";
+    for (int i = 0; i < elements; i++) {
+        transaction += (i == 0) ? "0" : "," + std::to_string(i % 10);
+    }
+    transaction += R"(],"last":"x"})";
+    const uint32_t total_tokens = elements + 5;
+
+    parsed_json_t parsed_json;
+    EXPECT_EQ(json_parse(&parsed_json, transaction.c_str(), transaction.size()), parser_json_too_many_tokens);
+
+    // Misaligned on purpose, the tables must still be usable
+    std::vector<uint8_t> spill(1 + elements * JSON_SPILL_BYTES_PER_TOKEN);
+    const json_parse_config_t config = {NULL, spill.data() + 1, (uint16_t)(spill.size() - 1)};
+    ASSERT_EQ(json_parse_with_config(&parsed_json, transaction.c_str(), transaction.size(), &config), parser_ok);
+    ASSERT_EQ(parsed_json.numberOfTokens, total_tokens);
+
+    uint16_t token_index = 0;
+    ASSERT_EQ(object_get_value(&parsed_json, 0, "last", &token_index), parser_ok);
+    EXPECT_GE(token_index, MAX_NUMBER_OF_TOKENS);
+    const jsmntok_t *last = json_get_token(&parsed_json, token_index);
+    EXPECT_EQ(JSMN_TOKEN_TYPE(last), JSMN_STRING);
+    EXPECT_EQ(transaction.substr(JSMN_TOKEN_START(last), JSMN_TOKEN_LEN(last)), "x");
+
+    // Elements on both sides of the tier boundary
+    uint16_t count = 0;
+    EXPECT_EQ(array_get_element_count(&parsed_json, 2, &count), parser_ok);
+    EXPECT_EQ(count, elements);
+    for (uint16_t i = MAX_NUMBER_OF_TOKENS - 4; i < MAX_NUMBER_OF_TOKENS + 4; i++) {
+        ASSERT_EQ(array_get_nth_element(&parsed_json, 2, i, &token_index), parser_ok);
+        const jsmntok_t *element = json_get_token(&parsed_json, token_index);
+        EXPECT_EQ(transaction[JSMN_TOKEN_START(element)], '0' + i % 10) << i;
+    }
+
+    // Streaming fills the RAM tier and continues in the spill buffer once the upload is complete
+    for (size_t received : {transaction.size() / 8, transaction.size() / 2}) {
+        parsed_json_t streamed;
+        json_parse_stream_init(&streamed, NULL);
+        json_parse_stream_append(&streamed, transaction.c_str(), received);
+        ASSERT_EQ(json_parse_stream_finish(&streamed, transaction.c_str(), transaction.size(), &config), parser_ok)
+            << received;
+        ASSERT_EQ(streamed.numberOfTokens, total_tokens) << received;
+        for (uint16_t i = 0; i < total_tokens; i++) {
+            EXPECT_EQ(json_get_token(&streamed, i)->start_type, json_get_token(&parsed_json, i)->start_type) << i;
+        }
+    }
+
+    // Still bounded by the size of the spill buffer
+    const json_parse_config_t small = {NULL, spill.data(), (uint16_t)(JSON_SPILL_BYTES_PER_TOKEN * 8)};
+    EXPECT_EQ(json_parse_with_config(&parsed_json, transaction.c_str(), transaction.size(), &small),
+              parser_json_too_many_tokens);
+}
+
+std::string signer_scope_tx(const std::string &signers) {
+    return R"({"networkId":"mainnet01","payload":{},"signers":)" + signers +
+           R"(,"meta":{"creationTime":1,"ttl":2,"gasLimit":3,"chainId":"0","gasPrice":4,"sender":"x"},"nonce":"n"})";
+}
+
+TEST(TxValidationTest, SignerScopedLookup) {
+    const std::string key_a(KEY_HEX_LEN, 'a');
+    const std::string key_b(KEY_HEX_LEN, 'b');
+    const std::string tx = signer_scope_tx(
+        R"([{"pubKey":")" + key_a + R"(","clist":[{"args":["k:)" + key_a + R"(","x",1],"name":"coin.TRANSFER"}]},)" +
+        R"({"pubKey":")" + key_b + R"(","clist":[{"args":[")" + key_a + R"(",")" + key_b.substr(1) +
+        R"("],"name":"m.C"}]},{"pubKey":")" + key_b + R"("}])");
+
+    parser_context_t ctx;
+    ASSERT_EQ(parser_parse(&ctx, (const uint8_t *)tx.c_str(), tx.size(), tx_type_json), parser_ok);
+    EXPECT_EQ(parser_getCmdIndex()->numberOfClistKeys, 2);
+    EXPECT_FALSE(parser_getCmdIndex()->clistKeysOverflow);
+
+    EXPECT_EQ(parser_isSignerScoped(0), parser_ok);
+    // Keys are only looked up in the clist of their own signer, and must match whole
+    EXPECT_EQ(parser_isSignerScoped(1), parser_no_data);
+    EXPECT_EQ(parser_isSignerScoped(2), parser_no_data);
+    EXPECT_EQ(parser_isSignerScoped(3), parser_no_data);
+}
+
+TEST(TxValidationTest, SignerScopedLookupOverflow) {
+    const std::string key_a(KEY_HEX_LEN, 'a');
+    std::string args;
+    for (int i = 0; i < MAX_NUMBER_OF_CLIST_KEYS + 4; i++) {
+        args += "\"" + std::string(KEY_HEX_LEN - 2, 'c') + std::to_string(10 + i) + "\",";
+    }
+    const std::string tx = signer_scope_tx(R"([{"pubKey":")" + key_a + R"(","clist":[{"args":[)" + args + R"("k:)" +
+                                           key_a + R"("],"name":"m.C"}]}])");
+
+    parser_context_t ctx;
+    ASSERT_EQ(parser_parse(&ctx, (const uint8_t *)tx.c_str(), tx.size(), tx_type_json), parser_ok);
+    EXPECT_EQ(parser_getCmdIndex()->numberOfClistKeys, MAX_NUMBER_OF_CLIST_KEYS);
+    EXPECT_TRUE(parser_getCmdIndex()->clistKeysOverflow);
+    EXPECT_EQ(parser_isSignerScoped(0), parser_ok);
+}
+
+// Transfer fields in the order the legacy and INS_SIGN_TRANSFER commands send them
+std::vector<uint8_t> transfer_input(uint8_t tx_type, const std::vector<std::string> &fields) {
+    std::vector<uint8_t> input = {tx_type};
+    for (const auto &field : fields) {
+        input.push_back((uint8_t)field.size());
+        input.insert(input.end(), field.begin(), field.end());
+    }
+    return input;
+}
+
+// Tokens recorded while the transfer template is written must be the ones jsmn produces for it
+void check_template_tokens(uint8_t tx_type, const std::string &module, const std::string &gas_price) {
+    const std::string recipient(64, 'b');
+    const std::vector<uint8_t> input =
+        transfer_input(tx_type, {recipient, tx_type == 2 ? "1" : "", "mainnet01", "1.5", module.empty() ? "" : "free",
+                                 module, gas_price, "2300", "1665647810", "0", "nonce", "28800"});
+
+    parser_context_t ctx;
+    ASSERT_EQ(parser_parse(&ctx, input.data(), input.size(), tx_type_transfer), parser_ok);
+    const parsed_json_t *generated = &parser_getParserJsonObj()->json;
+    const std::string tmpl(generated->buffer, generated->bufferLen);
+
+    static parsed_json_t tokenized;
+    const json_parse_config_t config = {&cmd_opaque_keys, NULL, 0};
+    ASSERT_EQ(json_parse_with_config(&tokenized, tmpl.c_str(), tmpl.size(), &config), parser_ok);
+    ASSERT_EQ(generated->numberOfTokens, tokenized.numberOfTokens) << tmpl;
+    for (uint16_t i = 0; i < tokenized.numberOfTokens; i++) {
+        EXPECT_EQ(generated->tokens[i].start_type, tokenized.tokens[i].start_type) << i;
+        EXPECT_EQ(generated->tokens[i].end, tokenized.tokens[i].end) << i;
+        EXPECT_EQ(generated->nextSibling[i], tokenized.nextSibling[i]) << i;
+        EXPECT_EQ(generated->keyHash[i], tokenized.keyHash[i]) << i;
+    }
+}
+
+TEST(TxValidationTest, TransferTemplateTokens) {
+    for (uint8_t tx_type = 0; tx_type < 3; tx_type++) {
+        check_template_tokens(tx_type, "", "1.0e-6");
+        check_template_tokens(tx_type, "tok", "1.0e-6");
+        // Not a single primitive for jsmn, the template is tokenized instead
+        check_template_tokens(tx_type, "", "1.0e-6 ");
+    }
+}
+
+std::vector<uint8_t> upload_transaction(size_t length, size_t read_at) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(i * 7 + i / 251);
+    }
+
+    tx_initialize();
+    tx_reset();
+    const size_t chunk = 250;
+    for (size_t offset = 0; offset < length; offset += chunk) {
+        const uint32_t len = (uint32_t)std::min(chunk, length - offset);
+        EXPECT_EQ(tx_append(data.data() + offset, len), len);
+        if (offset <= read_at && read_at < offset + len) {
+            EXPECT_EQ(memcmp(tx_get_buffer(), data.data(), offset + len), 0);
+        }
+    }
+    return data;
+}
+
+TEST(TxBufferTest, FlashIsWrittenByWholePages) {
+    const size_t length = 16384;
+    const std::vector<uint8_t> data = upload_transaction(length, length);
+
+    ASSERT_EQ(tx_get_buffer_length(), length);
+    EXPECT_EQ(memcmp(tx_get_buffer(), data.data(), length), 0);
+    EXPECT_EQ(tx_get_nvm_pages_written(), length / TX_NVM_PAGE_SIZE);
+}
+
+TEST(TxBufferTest, FullBufferParses) {
+    // A transaction that fills the whole transaction buffer
+    std::string tx = signer_scope_tx(R"([{"pubKey":")" + std::string(KEY_HEX_LEN, 'a') + R"("}])");
+    const std::string nonce = R"("nonce":"n")";
+    tx.insert(tx.find(nonce) + nonce.size() - 1, std::string(JSMN_MAX_LENGTH - tx.size(), 'n'));
+    ASSERT_EQ(tx.size(), JSMN_MAX_LENGTH);
+
+    tx_initialize();
+    tx_reset();
+    for (size_t offset = 0; offset < tx.size(); offset += 250) {
+        const uint32_t len = (uint32_t)std::min<size_t>(250, tx.size() - offset);
+        ASSERT_EQ(tx_append((uint8_t *)tx.data() + offset, len), len);
+    }
+    uint8_t extra = ' ';
+    EXPECT_EQ(tx_append(&extra, 1), 0u);
+
+    parser_context_t ctx;
+    EXPECT_EQ(parser_parse(&ctx, tx_get_buffer(), tx_get_buffer_length(), tx_type_json), parser_ok);
+}
+
+TEST(TxBufferTest, ReadingCommitsThePartialPage) {
+    const size_t length = 16000;
+    // Reading in the middle of the upload programs the staged page once more
+    const std::vector<uint8_t> data = upload_transaction(length, 12000);
+
+    ASSERT_EQ(tx_get_buffer_length(), length);
+    EXPECT_EQ(memcmp(tx_get_buffer(), data.data(), length), 0);
+    EXPECT_EQ(tx_get_nvm_pages_written(), (length + TX_NVM_PAGE_SIZE - 1) / TX_NVM_PAGE_SIZE + 1);
+}
+
 TEST(TxValidationTest, ObjectGetValueCorrectFormat) {
     auto transaction =
         R"({"account_number":"0","chain_id":"test-chain-1","fee":{"amount":[{"amount":"5","denom":"photon"}],"gas":"10000"},"memo":"testmemo","msgs":[{"inputs":[{"address":"cosmosaccaddr1d9h8qat5e4ehc5","coins":[{"amount":"10","denom":"atom"}]}],"outputs":[{"address":"cosmosaccaddr1da6hgur4wse3jx32","coins":[{"amount":"10","denom":"atom"}]}]}],"sequence":"1"})";
@@ -26,6 +26,11 @@
 #include "parser.h"
 #include "utils/common.h"
 
+extern "C" {
+#include "items.h"
+#include "items_format.h"
+}
+
 using json = nlohmann::json;
 
 using ::testing::TestWithParam;
@@ -127,5 +132,111 @@ INSTANTIATE_TEST_SUITE_P
     (JsonTestCasesCurrentTxVer, JsonTestsA, ::testing::ValuesIn(GetJsonTestCases("testcases.json")),
      JsonTestsA::PrintToStringParamName());
 
+// Any window of a value must match the same slice of the whole value, and measuring must agree with it
+void check_windowed_render(const testcase_t &tc, bool expert_mode) {
+    app_mode_set_expert(expert_mode);
+
+    parser_context_t ctx;
+    uint8_t buffer[5000];
+    MEMZERO(buffer, sizeof(buffer));
+    parseHexString(buffer, sizeof(buffer), tc.blob.c_str());
+    ASSERT_EQ(parser_parse(&ctx, buffer, strlen((char *)buffer), tx_type_json), parser_ok);
+    ASSERT_EQ(parser_validate(&ctx), parser_ok);
+
+    const item_array_t *item_array = items_getItemArray();
+    for (uint8_t idx = 0; idx < item_array->numOfItems; idx++) {
+        const item_t item = item_array->items[idx];
+        const item_formatter_t formatter = items_getFormatter(item.key);
+        ASSERT_NE(formatter, nullptr);
+
+        char full[MAX_ITEM_LENGTH_TO_DISPLAY + 1] = {0};
+        item_writer_t writer;
+        items_writerInit(&writer, full, MAX_ITEM_LENGTH_TO_DISPLAY, 0);
+        ASSERT_EQ(formatter(item, &writer), items_ok);
+        const std::string value(full, writer.valueLen);
+
+        uint32_t measured = 0;
+        ASSERT_EQ(items_measure(item, &measured), items_ok);
+        EXPECT_EQ(measured, value.size()) << (int)idx;
+
+        for (uint16_t windowLen : {1, 7, 38}) {
+            for (uint32_t windowStart = 0; windowStart < value.size(); windowStart += windowLen) {
+                char window[40] = {0};
+                items_writerInit(&writer, window, windowLen, windowStart);
+                ASSERT_EQ(formatter(item, &writer), items_ok);
+                EXPECT_EQ(std::string(window), value.substr(windowStart, windowLen)) << (int)idx << "@" << windowStart;
+            }
+        }
+    }
+}
+
+TEST_P(JsonTestsA, WindowedRender) {
+    check_windowed_render(GetParam(), false);
+    check_windowed_render(GetParam(), true);
+}
+
+// Titles must not depend on the order in which the items are visited
+TEST_P(JsonTestsA, RandomAccessTitles) {
+    app_mode_set_expert(false);
+
+    parser_context_t ctx;
+    uint8_t buffer[5000];
+    MEMZERO(buffer, sizeof(buffer));
+    parseHexString(buffer, sizeof(buffer), GetParam().blob.c_str());
+    ASSERT_EQ(parser_parse(&ctx, buffer, strlen((char *)buffer), tx_type_json), parser_ok);
+
+    uint8_t numItems = 0;
+    ASSERT_EQ(parser_getNumItems(&ctx, &numItems), parser_ok);
+
+    std::vector<std::string> forward;
+    char key[40];
+    char value[40];
+    uint8_t pageCount = 0;
+    for (uint8_t idx = 0; idx < numItems; idx++) {
+        ASSERT_EQ(parser_getItem(&ctx, idx, key, sizeof(key), value, sizeof(value), 0, &pageCount), parser_ok);
+        forward.push_back(key);
+    }
+
+    for (int idx = numItems - 1; idx >= 0; idx--) {
+        ASSERT_EQ(parser_getItem(&ctx, idx, key, sizeof(key), value, sizeof(value), 0, &pageCount), parser_ok);
+        EXPECT_EQ(forward[idx], key) << idx;
+    }
+}
+
+// Values must not depend on the order in which the items are visited, whatever the render cache kept
+TEST_P(JsonTestsA, RandomAccessValues) {
+    app_mode_set_expert(false);
+
+    parser_context_t ctx;
+    uint8_t buffer[5000];
+    MEMZERO(buffer, sizeof(buffer));
+    parseHexString(buffer, sizeof(buffer), GetParam().blob.c_str());
+
+    auto collect = [&](bool reverse) {
+        std::vector<std::string> pages;
+        EXPECT_EQ(parser_parse(&ctx, buffer, strlen((char *)buffer), tx_type_json), parser_ok);
+        uint8_t numItems = 0;
+        EXPECT_EQ(parser_getNumItems(&ctx, &numItems), parser_ok);
+        pages.resize(numItems);
+
+        char key[40];
+        char value[40];
+        for (uint8_t i = 0; i < numItems; i++) {
+            const uint8_t idx = reverse ? numItems - 1 - i : i;
+            uint8_t pageCount = 1;
+            for (uint8_t page = 0; page < pageCount; page++) {
+                EXPECT_EQ(parser_getItem(&ctx, idx, key, sizeof(key), value, sizeof(value), page, &pageCount),
+                          parser_ok);
+                pages[idx] += value;
+            }
+        }
+        return pages;
+    };
+
+    const std::vector<std::string> backward = collect(true);
+    const std::vector<std::string> forward = collect(false);
+    EXPECT_EQ(forward, backward);
+}
+
 TEST_P(JsonTestsA, CheckUIOutput_CurrentTX_Expert) { check_testcase(GetParam(), true); }
 TEST_P(JsonTestsA, CheckUIOutput_CurrentTX) { check_testcase(GetParam(), false); }
\ No newline at end of file